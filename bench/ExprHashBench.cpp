@@ -0,0 +1,178 @@
+// Measures expression hash quality and hash table throughput.
+//
+// Builds a population of path-condition-like expressions (sums of symbols
+// and constants in both operand orders, comparisons against constants and
+// between sums) and reports how many of them share a hash under the old
+// 32-bit shift/xor scheme and under the current 64-bit one. It then times
+// insert, hit and miss lookups in ExprHashMap against std::unordered_map
+// keyed on the same cached hash.
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Expr.h"
+#include "ExprHashMap.h"
+
+using namespace miniklee;
+
+namespace {
+
+const unsigned NumSymbols = 16;
+const unsigned NumExprs = 200000;
+const unsigned Lookups = 2000000;
+
+typedef std::chrono::steady_clock Clock;
+
+double nsPer(Clock::time_point start, unsigned ops) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - start).count();
+    return static_cast<double>(ns) / ops;
+}
+
+/// The hash Expr::computeHash used to compute.
+unsigned legacyHash(const Expr *e, std::unordered_map<const Expr *, unsigned> &memo) {
+    const unsigned Magic = 39;
+    auto it = memo.find(e);
+    if (it != memo.end())
+        return it->second;
+
+    unsigned res;
+    switch (e->getKind()) {
+    case Expr::Constant:
+        res = cast<ConstantExpr>(e)->getAPValue().getLimitedValue() ^ (e->getWidth() * Magic);
+        break;
+    case Expr::Symbolic:
+        res = std::hash<std::string>()(cast<SymbolicExpr>(e)->getName()) ^ (e->getWidth() * Magic);
+        break;
+    case Expr::Not:
+        res = legacyHash(e->getKid(0).get(), memo) * Magic * Expr::Not;
+        break;
+    default:
+        res = e->getKind() * Magic;
+        for (unsigned i = 0; i < e->getNumKids(); ++i) {
+            res <<= 1;
+            res ^= legacyHash(e->getKid(i).get(), memo) * Magic;
+        }
+    }
+    memo[e] = res;
+    return res;
+}
+
+std::vector<ref<Expr>> makePopulation(std::mt19937 &rng, unsigned n) {
+    std::vector<ref<Expr>> symbols;
+    for (unsigned i = 0; i < NumSymbols; ++i)
+        symbols.push_back(SymbolicExpr::create("x" + std::to_string(i)));
+
+    auto symbol = [&] { return symbols[rng() % NumSymbols]; };
+    auto constant = [&] {
+        return ConstantExpr::create(rng() % 2048, Expr::Int32);
+    };
+    // a + b, a - b or c + a, nested up to three deep
+    std::function<ref<Expr>(unsigned)> term = [&](unsigned depth) -> ref<Expr> {
+        if (depth == 0)
+            return symbol();
+        switch (rng() % 4) {
+        case 0:  return AddExpr::alloc(term(depth - 1), term(depth - 1));
+        case 1:  return SubExpr::alloc(term(depth - 1), term(depth - 1));
+        case 2:  return AddExpr::alloc(constant(), term(depth - 1));
+        default: return symbol();
+        }
+    };
+
+    std::unordered_set<const Expr *> seen;
+    std::vector<ref<Expr>> exprs;
+    while (exprs.size() < n) {
+        ref<Expr> e;
+        switch (rng() % 4) {
+        case 0:  e = EqExpr::alloc(constant(), term(3)); break;
+        case 1:  e = SltExpr::alloc(term(2), term(2)); break;
+        case 2:  e = NotExpr::alloc(EqExpr::alloc(constant(), term(3))); break;
+        default: e = term(3); break;
+        }
+        if (seen.insert(e.get()).second)
+            exprs.push_back(e);
+    }
+    return exprs;
+}
+
+template <typename Hash>
+void reportCollisions(const char *name, const std::vector<ref<Expr>> &exprs, Hash hash) {
+    std::unordered_map<std::uint64_t, unsigned> buckets;
+    for (const ref<Expr> &e : exprs)
+        ++buckets[hash(e.get())];
+    unsigned shared = 0, worst = 0;
+    for (const auto &b : buckets) {
+        if (b.second > 1)
+            shared += b.second;
+        worst = std::max(worst, b.second);
+    }
+    std::printf("%-14s %8zu distinct hashes, %6u exprs share a hash, worst %u\n",
+                name, buckets.size(), shared, worst);
+}
+
+struct CachedHash {
+    std::size_t operator()(const ref<Expr> &e) const { return e->hash(); }
+};
+
+struct SameNode {
+    bool operator()(const ref<Expr> &a, const ref<Expr> &b) const {
+        return a.get() == b.get();
+    }
+};
+
+template <typename Map>
+void runTable(const char *name, const std::vector<ref<Expr>> &exprs,
+              const std::vector<ref<Expr>> &absent) {
+    auto start = Clock::now();
+    Map m;
+    for (unsigned i = 0; i < exprs.size(); ++i)
+        m[exprs[i]] = i;
+    double insert = nsPer(start, exprs.size());
+
+    unsigned found = 0;
+    start = Clock::now();
+    for (unsigned i = 0; i < Lookups; ++i)
+        found += m.find(exprs[(i * 7919u) % exprs.size()]) != m.end();
+    double hit = nsPer(start, Lookups);
+
+    start = Clock::now();
+    for (unsigned i = 0; i < Lookups; ++i)
+        found += m.find(absent[(i * 7919u) % absent.size()]) != m.end();
+    double miss = nsPer(start, Lookups);
+
+    std::printf("%-14s %8.2f ns/insert %8.2f ns/hit %8.2f ns/miss (%u found)\n",
+                name, insert, hit, miss, found);
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(42);
+    std::vector<ref<Expr>> exprs = makePopulation(rng, NumExprs);
+    std::vector<ref<Expr>> absent;
+    {
+        std::unordered_set<const Expr *> present;
+        for (const ref<Expr> &e : exprs)
+            present.insert(e.get());
+        for (const ref<Expr> &e : makePopulation(rng, NumExprs / 4))
+            if (!present.count(e.get()))
+                absent.push_back(e);
+    }
+
+    std::unordered_map<const Expr *, unsigned> memo;
+    std::printf("%u expressions\n", NumExprs);
+    reportCollisions("legacy 32-bit", exprs,
+                     [&](const Expr *e) { return legacyHash(e, memo); });
+    reportCollisions("64-bit", exprs, [](const Expr *e) { return e->hash(); });
+
+    runTable<std::unordered_map<ref<Expr>, unsigned, CachedHash, SameNode>>(
+        "unordered_map", exprs, absent);
+    runTable<ExprHashMap<unsigned>>("ExprHashMap", exprs, absent);
+    return 0;
+}
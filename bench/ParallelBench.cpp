@@ -0,0 +1,105 @@
+// Measures how exploration with work-stealing workers scales.
+//
+// The program under test makes Depth symbolic integers and branches on
+// each in turn, so every path forks at every level and the tree has
+// 2^Depth leaves, spread evenly over the workers' queues. It is run once
+// with the sequential interpreter and then with 1, 2 and 4 workers; each
+// run reports the paths explored, the wall time and the speedup over one
+// worker. Every worker owns its solver chain, so the caches are not
+// shared and more workers may issue more solver queries in total.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include <llvm/AsmParser/Parser.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/SourceMgr.h>
+
+#include "Executor.h"
+
+namespace {
+
+const unsigned Depth = 12;
+const unsigned MaxWorkers = 4;
+
+typedef std::chrono::steady_clock Clock;
+
+/// IR for a main() that branches once on each of Depth symbols.
+std::string makeProgram() {
+    std::string ir;
+    // Symbols are told apart by name, so give each its own.
+    for (unsigned i = 0; i < Depth; ++i)
+        ir += "@s" + std::to_string(i) + " = private constant [2 x i8] c\"" +
+              char('a' + i) + "\\00\"\n";
+    ir += "define i32 @main() {\nentry:\n";
+    for (unsigned i = 0; i < Depth; ++i) {
+        std::string n = std::to_string(i);
+        ir += "  %a" + n + " = alloca i32, align 4\n";
+        ir += "  call void @make_symbolic(i32* %a" + n + ", i64 4, i8* "
+              "getelementptr inbounds ([2 x i8], [2 x i8]* @s" + n + ", i64 0, i64 0))\n";
+    }
+    ir += "  br label %b0\n";
+    for (unsigned i = 0; i < Depth; ++i) {
+        std::string n = std::to_string(i), next = std::to_string(i + 1);
+        ir += "b" + n + ":\n";
+        ir += "  %v" + n + " = load i32, i32* %a" + n + ", align 4\n";
+        ir += "  %c" + n + " = icmp eq i32 %v" + n + ", " + n + "\n";
+        ir += "  br i1 %c" + n + ", label %t" + n + ", label %b" + next + "\n";
+        ir += "t" + n + ":\n  br label %b" + next + "\n";
+    }
+    ir += "b" + std::to_string(Depth) + ":\n  ret i32 0\n}\n";
+    ir += "declare void @make_symbolic(i32*, i64, i8*)\n";
+    return ir;
+}
+
+/// Explore the program with \p workers threads, or sequentially if 0.
+/// Returns the wall time in milliseconds.
+double run(const std::string &ir, unsigned workers, std::uint64_t &paths) {
+    llvm::LLVMContext context;
+    llvm::SMDiagnostic err;
+    auto module = llvm::parseAssemblyString(ir, err, context);
+    if (!module) {
+        err.print("ParallelBench", llvm::errs());
+        std::exit(1);
+    }
+
+    Executor executor(std::move(module));
+    llvm::Function *main = executor.module->getFunction("main");
+    auto start = Clock::now();
+    if (workers)
+        executor.runFunctionAsMainParallel(main, workers);
+    else
+        executor.runFunctionAsMain(main);
+    paths = executor.pathsExplored;
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+} // namespace
+
+int main() {
+    if (!DefaultRefCountPolicy::ThreadSafe) {
+        std::printf("workers need atomic reference counts; skipped\n");
+        return 0;
+    }
+
+    std::string ir = makeProgram();
+    std::uint64_t paths = 0;
+    double ms = run(ir, 0, paths);
+    std::printf("sequential %6llu paths %8.1f ms\n",
+                static_cast<unsigned long long>(paths), ms);
+
+    double base = 0;
+    for (unsigned workers = 1; workers <= MaxWorkers; workers *= 2) {
+        ms = run(ir, workers, paths);
+        if (workers == 1)
+            base = ms;
+        std::printf("%u workers  %6llu paths %8.1f ms  %4.2fx\n", workers,
+                    static_cast<unsigned long long>(paths), ms, base / ms);
+    }
+    std::printf("(%u hardware threads)\n", std::thread::hardware_concurrency());
+    return 0;
+}
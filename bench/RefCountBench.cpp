@@ -0,0 +1,112 @@
+// Measures the cost of ref<T> copies and destruction under each reference
+// counting policy.
+//
+// A copy pass assigns refs between two arrays, so every assignment
+// increments one count and decrements another, as forking a state's
+// registers and dropping the old ones does. A churn pass creates and
+// destroys a temporary ref to one hot object, the pattern of passing
+// expressions by value. The atomic policy is also timed with several
+// threads copying refs to the same objects, which plain counts cannot do.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "Ref.h"
+
+namespace {
+
+const unsigned NumObjects = 4096;
+const unsigned Rounds = 2000;
+const unsigned Churns = 20000000;
+const unsigned MaxThreads = 4;
+
+typedef std::chrono::steady_clock Clock;
+
+double nsPer(Clock::time_point start, std::uint64_t ops) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - start).count();
+    return static_cast<double>(ns) / ops;
+}
+
+template <class Policy>
+struct Object {
+    ReferenceCounter<Policy> _refCount;
+    unsigned payload = 0;
+};
+
+template <class Policy>
+using Ref = ref<Object<Policy>, Policy>;
+
+/// Keeps results alive so the loops are not optimized out.
+std::atomic<unsigned> sink(0);
+
+template <class Policy>
+double copyPass(const std::vector<Ref<Policy>> &src) {
+    std::vector<Ref<Policy>> dst(src.size());
+    auto start = Clock::now();
+    for (unsigned r = 0; r < Rounds; ++r)
+        for (unsigned i = 0; i < src.size(); ++i)
+            dst[i] = src[(i + r) % src.size()];
+    double ns = nsPer(start, std::uint64_t(Rounds) * src.size());
+    sink += dst[0]->payload;
+    return ns;
+}
+
+template <class Policy>
+__attribute__((noinline)) unsigned use(Ref<Policy> r) { return r->payload; }
+
+template <class Policy>
+double churnPass(const Ref<Policy> &hot) {
+    unsigned sum = 0;
+    auto start = Clock::now();
+    for (unsigned i = 0; i < Churns; ++i)
+        sum += use<Policy>(hot);
+    double ns = nsPer(start, Churns);
+    sink += sum;
+    return ns;
+}
+
+template <class Policy>
+void run(const char *name) {
+    std::vector<Ref<Policy>> objects;
+    for (unsigned i = 0; i < NumObjects; ++i)
+        objects.push_back(new Object<Policy>());
+
+    double copy = copyPass<Policy>(objects);
+    double churn = churnPass<Policy>(objects[0]);
+    std::printf("%-8s %6.2f ns/copy %6.2f ns/churn\n", name, copy, churn);
+}
+
+void runShared(unsigned threads) {
+    typedef AtomicRefCount Policy;
+    std::vector<Ref<Policy>> objects;
+    for (unsigned i = 0; i < NumObjects; ++i)
+        objects.push_back(new Object<Policy>());
+
+    std::vector<double> ns(threads);
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t)
+        workers.emplace_back([&, t] { ns[t] = copyPass<Policy>(objects); });
+    for (std::thread &w : workers)
+        w.join();
+
+    double total = 0;
+    for (double n : ns)
+        total += n;
+    std::printf("atomic, %u threads sharing %6.2f ns/copy\n", threads, total / threads);
+}
+
+} // namespace
+
+int main() {
+    run<PlainRefCount>("plain");
+    run<AtomicRefCount>("atomic");
+    for (unsigned threads = 2; threads <= MaxThreads; threads *= 2)
+        runShared(threads);
+    std::printf("(default policy: %s)\n",
+                DefaultRefCountPolicy::ThreadSafe ? "atomic" : "plain");
+    return sink == 0xdeadbeef;
+}
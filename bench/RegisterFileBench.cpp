@@ -0,0 +1,99 @@
+// Measures the per-instruction cost of the interpreter's register file.
+//
+// Replays the Load/Add/Store pattern of `a = a + 2` from test/loop.c
+// against the old hash-map locals (erase + insert on every write) and the
+// slot-indexed vector and the copy-on-write RegisterFile used by
+// ExecutionState, then times a fork-style copy of each.
+
+#include <chrono>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+#include "Expr.h"
+#include "RegisterFile.h"
+
+using namespace miniklee;
+
+namespace {
+
+const unsigned NumRegisters = 64;
+const unsigned Iterations = 2000000;
+const unsigned Forks = 200000;
+
+typedef std::chrono::steady_clock Clock;
+
+double nsPer(Clock::time_point start, unsigned ops) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - start).count();
+    return static_cast<double>(ns) / ops;
+}
+
+// The baseline: what Executor::executeMemoryOperation did before.
+struct MapLocals {
+    std::unordered_map<const void *, ref<Expr>> locals;
+    std::vector<char> keys = std::vector<char>(NumRegisters);
+
+    const void *key(unsigned r) const { return &keys[r]; }
+
+    ref<Expr> read(unsigned r) { return locals.find(key(r))->second; }
+
+    void write(unsigned r, ref<Expr> v) {
+        auto it = locals.find(key(r));
+        if (it != locals.end())
+            locals.erase(it);
+        locals.insert({key(r), v});
+    }
+};
+
+struct SlotLocals {
+    std::vector<ref<Expr>> locals = std::vector<ref<Expr>>(NumRegisters);
+
+    ref<Expr> read(unsigned r) { return locals[r]; }
+    void write(unsigned r, ref<Expr> v) { locals[r] = std::move(v); }
+};
+
+struct CowLocals {
+    RegisterFile locals = RegisterFile(NumRegisters);
+
+    ref<Expr> read(unsigned r) { return locals[r]; }
+    void write(unsigned r, ref<Expr> v) { locals.set(r, std::move(v)); }
+};
+
+template <typename Locals>
+void run(const char *name) {
+    Locals l;
+    ref<Expr> two = ConstantExpr::create(2, Expr::Int32);
+    for (unsigned r = 0; r < NumRegisters; ++r)
+        l.write(r, ConstantExpr::create(0, Expr::Int32));
+
+    // Three instructions per iteration: Load, Add, Store.
+    auto start = Clock::now();
+    for (unsigned i = 0; i < Iterations; ++i) {
+        unsigned cell = i % (NumRegisters / 2);
+        unsigned tmp = NumRegisters / 2 + cell;
+        l.write(tmp, l.read(cell));
+        l.write(tmp, AddExpr::create(l.read(tmp), two));
+        l.write(cell, l.read(tmp));
+    }
+    double perInst = nsPer(start, 3 * Iterations);
+
+    start = Clock::now();
+    for (unsigned i = 0; i < Forks; ++i) {
+        Locals copy(l);
+        (void) copy;
+    }
+    double perFork = nsPer(start, Forks);
+
+    std::printf("%-8s %8.2f ns/instruction %10.2f ns/fork\n",
+                name, perInst, perFork);
+}
+
+} // namespace
+
+int main() {
+    run<MapLocals>("map");
+    run<SlotLocals>("slots");
+    run<CowLocals>("cow");
+    return 0;
+}
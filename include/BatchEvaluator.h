@@ -0,0 +1,102 @@
+#ifndef BATCHEVALUATOR_H
+#define BATCHEVALUATOR_H
+
+#include "Expr.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Build with -DMINIKLEE_BATCH_SCALAR to disable the SSE2/AVX2 kernels.
+/// AVX2 is used when the compiler targets it (-mavx2 or -march=native).
+
+namespace miniklee {
+
+/// Evaluates expressions over many concrete assignments at once, e.g. to
+/// check cached models or random samples against a path condition.
+///
+/// The expression DAG is compiled once into a linear register program,
+/// one instruction per distinct node, with registers recycled after their
+/// last use. The program is then run over the batch a block of lanes at a
+/// time, every instruction processing the whole block with SIMD. Constants
+/// are materialized once per call and inputs are read in place.
+///
+/// Input is column major: one array per symbol, in getSymbols() order,
+/// holding that symbol's value in each assignment. Arithmetic wraps and
+/// division by zero yields 0.
+class BatchEvaluator {
+public:
+    /// Assignments processed per pass over the program.
+    static const std::size_t BlockLanes = 256;
+
+    explicit BatchEvaluator(const ref<Expr> &root);
+    explicit BatchEvaluator(const std::vector<ref<Expr>> &roots);
+
+    /// Symbols read by the roots, in input column order.
+    const std::vector<const Symbol *> &getSymbols() const { return symbols; }
+
+    /// The column of \p symbol, or -1 if no root reads it.
+    int getSymbolIndex(const Symbol *symbol) const {
+        return symbol->id < columns.size() ? columns[symbol->id] : -1;
+    }
+
+    std::size_t getNumRoots() const { return roots.size(); }
+    std::size_t getNumInstructions() const { return program.size(); }
+
+    /// Evaluate every root over \p count assignments, writing the value of
+    /// root i for assignment j to outputs[i][j].
+    void evaluate(const std::int32_t *const *inputs, std::size_t count,
+                  std::int32_t *const *outputs) const;
+
+    /// Check \p count assignments against the conjunction of the roots,
+    /// which must all be Bool. Sets satisfied[j] to 0 or 1 and returns how
+    /// many assignments satisfy every root.
+    std::size_t filter(const std::int32_t *const *inputs, std::size_t count,
+                       std::uint8_t *satisfied) const;
+
+    enum class Op : std::uint8_t {
+        Const,
+        Input,
+        Not,
+        NotBool,
+        Add,
+        Sub,
+        Mul,
+        UDiv,
+        SDiv,
+        Eq,
+        Ult,
+        Ule,
+        Slt,
+        Sle
+    };
+
+    struct Instruction {
+        Op op;
+        std::uint32_t dest;
+        std::uint32_t a, b;
+        /// Constant value for Const, input column for Input.
+        std::int32_t imm;
+    };
+
+private:
+    std::vector<Instruction> program;
+    std::vector<const Symbol *> symbols;
+    /// Column of each symbol, indexed by Symbol::id; -1 if unused.
+    std::vector<std::int32_t> columns;
+    /// Register holding each root once the program has run.
+    std::vector<std::uint32_t> roots;
+    unsigned numRegisters = 0;
+
+    struct Frame;
+
+    void compile(const std::vector<ref<Expr>> &exprs);
+    void allocateRegisters();
+    void run(const std::int32_t *const *inputs, std::size_t base,
+             std::size_t lanes, Frame &frame) const;
+};
+
+} // namespace miniklee
+
+#endif // BATCHEVALUATOR_H
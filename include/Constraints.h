@@ -3,26 +3,122 @@
 
 #include "Expr.h"
 
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <vector>
+
 namespace miniklee {
 
 /// Resembles a set of constraints that can be passed around
 ///
+/// The set is a persistent list: every push_back prepends a node that points
+/// to the previous contents, so copying a set (e.g. when a state forks) is a
+/// single reference count bump and sibling sets share their common prefix.
+/// Its iterators visit the most recently added constraint first, hence
+/// their names; toVector() lists the constraints in the order they were
+/// added.
 class ConstraintSet {
+    struct Node {
+        ReferenceCounter<> _refCount;
+        ref<Expr> constraint;
+        ref<Node> parent;
+        size_t size;
+        /// Sum of the mixed hashes of this constraint and its parents.
+        std::uint64_t hash;
+
+        Node(const ref<Expr> &e, const ref<Node> &p)
+            : constraint(e), parent(p), size(p.isNull() ? 1 : p->size + 1),
+              hash((p.isNull() ? 0 : p->hash) + hashCombine(0, e->hash())) {}
+
+        ~Node() {
+            // Unlink iteratively so a long path does not recurse once per
+            // constraint when its last owner dies.
+            ref<Node> p = std::move(parent);
+            while (!p.isNull() && p->_refCount.getCount() == 1) {
+                ref<Node> next = std::move(p->parent);
+                p = std::move(next);
+            }
+        }
+    };
+
 public:
     using constraints_ty = std::vector<ref<Expr>>;
-    using iterator = constraints_ty::iterator;
-    using const_iterator = constraints_ty::const_iterator;
 
-    using constraint_iterator = const_iterator;
+    class constraint_iterator {
+        const Node *node;
 
-    bool empty() const { return constraints.empty(); }
-    constraint_iterator begin() const { return constraints.begin(); }
-    constraint_iterator end() const { return constraints.end(); }
-    size_t size() const noexcept { return constraints.size(); }
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = ref<Expr>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const ref<Expr> *;
+        using reference = const ref<Expr> &;
+
+        explicit constraint_iterator(const Node *n = nullptr) : node(n) {}
+
+        reference operator*() const { return node->constraint; }
+        pointer operator->() const { return &node->constraint; }
+
+        constraint_iterator &operator++() {
+            node = node->parent.get();
+            return *this;
+        }
+        constraint_iterator operator++(int) {
+            constraint_iterator tmp(*this);
+            ++*this;
+            return tmp;
+        }
+
+        bool operator==(const constraint_iterator &b) const { return node == b.node; }
+        bool operator!=(const constraint_iterator &b) const { return node != b.node; }
+    };
 
-    void push_back(const ref<Expr> &e) { constraints.push_back(e); }
+    using iterator = constraint_iterator;
+    using const_iterator = constraint_iterator;
 
-    explicit ConstraintSet(constraints_ty cs) : constraints(std::move(cs)) {}
+    bool empty() const { return head.isNull(); }
+    constraint_iterator newest_begin() const { return constraint_iterator(head.get()); }
+    constraint_iterator newest_end() const { return constraint_iterator(); }
+    size_t size() const noexcept { return head.isNull() ? 0 : head->size; }
+
+    /// A hash of the constraints that does not depend on the order they
+    /// were added in, kept up to date by push_back in O(1).
+    std::uint64_t hash() const { return head.isNull() ? 0 : head->hash; }
+
+    /// Whether both sets hold the same constraints, counted with
+    /// multiplicity, in any order. O(1) when they share their newest node.
+    bool sameConstraints(const ConstraintSet &b) const;
+
+    /// The constraints, oldest first.
+    constraints_ty toVector() const {
+        constraints_ty res(size());
+        auto out = res.rbegin();
+        for (const Node *n = head.get(); n; n = n->parent.get())
+            *out++ = n->constraint;
+        return res;
+    }
+
+    void push_back(const ref<Expr> &e) { head = new Node(e, head); }
+
+    /// The most recently added constraint.
+    const ref<Expr> &back() const {
+        assert(!empty() && "Empty constraint set");
+        return head->constraint;
+    }
+
+    /// The set as it was before its most recently added constraint. Shares
+    /// its nodes with this one, so it costs no copy.
+    ConstraintSet withoutBack() const {
+        assert(!empty() && "Empty constraint set");
+        return ConstraintSet(head->parent);
+    }
+
+    /// A set of \p cs, taken to be oldest first.
+    explicit ConstraintSet(constraints_ty cs) {
+        for (const auto &e : cs)
+            push_back(e);
+    }
     ConstraintSet() = default;
 
 
@@ -32,8 +128,28 @@ public:
     // }
 
     private:
-    constraints_ty constraints;
+    explicit ConstraintSet(const ref<Node> &head) : head(head) {}
+
+    ref<Node> head;
     };
+
+inline bool ConstraintSet::sameConstraints(const ConstraintSet &b) const {
+    if (head.get() == b.head.get())
+        return true;
+    if (size() != b.size() || hash() != b.hash())
+        return false;
+    // Expressions are hash-consed, so comparing pointers is exact.
+    std::vector<const Expr *> x, y;
+    x.reserve(size());
+    y.reserve(size());
+    for (const Node *n = head.get(); n; n = n->parent.get())
+        x.push_back(n->constraint.get());
+    for (const Node *n = b.head.get(); n; n = n->parent.get())
+        y.push_back(n->constraint.get());
+    std::sort(x.begin(), x.end());
+    std::sort(y.begin(), y.end());
+    return x == y;
+}
 } // miniklee
 
-#endif
\ No newline at end of file
+#endif
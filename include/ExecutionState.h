@@ -3,36 +3,42 @@
 
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/Value.h>
+#include <atomic>
 #include <unordered_map>
 #include <vector>
 #include <string>
 
 #include "Expr.h"
 #include "Constraints.h"
+#include "KModule.h"
+#include "RegisterFile.h"
 
 using namespace miniklee;
 
 class ExecutionState {
 public:
-    // FIXME:
-    // Use Iterator instead? Later just use ++pc to get next instruction
-    // When encountering a Branch instruction, check the condition and jump to the correct instruction
+    // Function whose decoded instructions pc points into
+    KFunction *kf = nullptr;
 
     // Pointer to instruction to be executed after the current instruction
-    llvm::BasicBlock::iterator pc;
+    KInstIterator pc = nullptr;
 
     // Pointer to instruction which is currently executed
-    // REMOVEME InstIterator prevPC;
-    llvm::BasicBlock::iterator prevPC;
+    KInstIterator prevPC = nullptr;
 
-    // Store symbolic variables and their values
-    std::unordered_map<const llvm::Value*, ref<Expr>> locals;
+    // Register file: one slot per value-producing instruction of kf,
+    // numbered while decoding. Allocas hold the value of their cell.
+    // Shared copy-on-write with the states forked from this one.
+    RegisterFile locals;
 
     // Path constraints collected so far
     ConstraintSet constraints;
 
-    // The global state counter
-    static std::uint32_t nextID;
+    // Number of forks on the path to this state
+    std::uint32_t depth = 0;
+
+    // The global state counter, shared by all worker threads
+    static std::atomic<std::uint32_t> nextID;
 
     // the state id
     std::uint32_t id = 0;
@@ -41,7 +47,7 @@ public:
     ExecutionState() {}
 
     // Only to create the initial state
-    ExecutionState(llvm::Function *f);
+    ExecutionState(KFunction *kf);
 
     // Copy constructor
     ExecutionState(const ExecutionState& state);
@@ -5,6 +5,12 @@
 #include <iostream>
 #include "ExecutionState.h"
 #include "Solver.h"
+#include "KModule.h"
+#include "Searcher.h"
+#include "WorkStealingQueue.h"
+
+#include <atomic>
+#include <unordered_set>
 
 using namespace llvm;
 
@@ -21,54 +27,44 @@ using namespace llvm;
 #define RED_TEXT(text)   COLOR_RED text COLOR_RESET
 #define GREY_TEXT(text)  COLOR_GREY text COLOR_RESET
 
-class StateManager {
+class Executor {
 public:
-    void addState(ExecutionState* state) {
-        states.push_back(state);
-    }
-
-    template <typename Iterator>
-    void addState(Iterator begin, Iterator end) {
-        states.insert(states.end(), begin, end);
-    }
-
-    ExecutionState& selectState() {
-        assert(!states.empty());
-        return *states.front();
-    }
+    std::unique_ptr<llvm::Module> module;
 
-    bool isEmpty() const { return states.empty(); }
+    /// Decoded functions; shared read-only with parallel workers.
+    std::shared_ptr<KModule> kmodule;
 
-    std::deque<ExecutionState*>::iterator find(ExecutionState* target) {
-        return std::find(states.begin(), states.end(), target);
-    }
+    std::unique_ptr<Solver> solver;
 
-    std::deque<ExecutionState*>::iterator begin() { return states.begin(); }
+    /// The set of all live states, owned by the executor.
+    std::unordered_set<ExecutionState*> states;
 
-    std::deque<ExecutionState*>::iterator end() { return states.end(); }
+    /// Chooses the next state to step.
+    std::unique_ptr<Searcher> searcher;
 
-    std::deque<ExecutionState*>::iterator erase(std::deque<ExecutionState*>::iterator pos) {
-        return states.erase(pos);
-    }
-
-private:
-    std::deque<ExecutionState*> states;
-};
-class Executor {
-public:
-    std::unique_ptr<llvm::Module> module;
-    
-    std::unique_ptr<Solver> solver;
-
-    StateManager states;
+    /// Random number generator shared by the random searchers.
+    std::mt19937 rng;
 
     typedef std::pair<ExecutionState*,ExecutionState*> StatePair;
 
+    /// Number of paths that ran to completion.
+    std::uint64_t pathsExplored = 0;
+
     void runFunctionAsMain(llvm::Function* function);
 
+    /// Explore with \p numThreads workers. Each worker owns a solver and a
+    /// WorkStealingQueue of states and steals from the others when idle.
+    /// The searcher is not used in this mode.
+    void runFunctionAsMainParallel(llvm::Function* function, unsigned numThreads);
+
     // Constructor that accepts an llvm::Module pointer
     explicit Executor(std::unique_ptr<llvm::Module> module);
 
+    Executor(const Executor &) = delete;
+    Executor &operator=(const Executor &) = delete;
+
+    void setSearcher(std::unique_ptr<Searcher> s) { searcher = std::move(s); }
+
     // Used to track states that have been added during the current
     // instructions step. 
     std::vector<ExecutionState *> addedStates;
@@ -77,24 +73,41 @@ public:
     std::vector<ExecutionState *> removedStates;
 
 private:
+    /// Most expression nodes freed per interpreter step. Deeper garbage,
+    /// such as the path condition of a finished state, is freed over the
+    /// following steps instead of in one pause.
+    static const std::size_t ReclaimBudget = 256;
+
+    // Worker executor sharing the decoded module \p kmodule.
+    explicit Executor(std::shared_ptr<KModule> kmodule);
+
+    /// A worker for runFunctionAsMainParallel with its own solver chain and
+    /// no module or searcher of its own.
+    std::unique_ptr<Executor> createWorker() const;
+
+    void runWorker(unsigned id,
+                   std::vector<std::unique_ptr<WorkStealingQueue>> &queues,
+                   std::atomic<std::size_t> &liveStates);
 
     void stepInstruction(ExecutionState& state);
 
-    void executeInstruction(ExecutionState& state, llvm::Instruction* inst);
+    void executeInstruction(ExecutionState& state, KInstIterator ki);
 
     void updateStates(ExecutionState *current);
 
-    void transferToBasicBlock(llvm::BasicBlock *dst, ExecutionState &state);
+    void transferToBasicBlock(unsigned entry, ExecutionState &state);
 
-    void executeAlloc(ExecutionState& state, unsigned size, llvm::Instruction* inst);
+    void executeAlloc(ExecutionState& state, unsigned size, KInstIterator ki);
 
-    ref<Expr> getInstructionValue(ExecutionState& state, llvm::Instruction* i);
+    ref<Expr> getInstructionValue(ExecutionState& state, unsigned reg);
 
-    void executeMemoryOperation(ExecutionState& state, bool isWrite, llvm::Instruction *address, ref<Expr> value, llvm::Instruction* i);
+    void executeMemoryOperation(ExecutionState& state, bool isWrite, unsigned address, ref<Expr> value, unsigned target);
 
-    ref<Expr> getValue(ExecutionState& state, Value* value /* ConstantInt* or Instruction* */);
+    /// Fetch operand \p index of \p ki, either from a register or from the
+    /// constants pre-materialized while decoding.
+    ref<Expr> getValue(ExecutionState& state, KInstIterator ki, unsigned index);
         
-    void executeMakeSymbolic(ExecutionState& state, Instruction *sym, std::string name);
+    void executeMakeSymbolic(ExecutionState& state, unsigned sym, const std::string &name);
 
     StatePair fork(ExecutionState &current, ref<Expr> condition);
 
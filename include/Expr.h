@@ -5,13 +5,31 @@
 #include "llvm/Support/Casting.h"
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
 #include "Ref.h"
+#include "ExprAllocator.h"
+#include "SymbolTable.h"
 
 namespace miniklee {
+struct ExprKey;
+class LinearForm;
+
+/// Fold \p value into the running hash \p seed. Order sensitive, so
+/// Add(a, b) and Add(b, a) hash differently.
+inline std::uint64_t hashCombine(std::uint64_t seed, std::uint64_t value) {
+    std::uint64_t h = seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+    // MurmurHash3 finalizer
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
 class Expr {
 public:
-    static unsigned count;
-    static const unsigned MAGIC_HASH_CONSTANT = 39;
+    static std::atomic<unsigned> count;
 
     // The type of an expression is simply its width, in bits. 
     typedef unsigned Width;
@@ -59,13 +77,31 @@ public:
     };
 
     /// @brief Required by klee::ref-managed objects
-    class ReferenceCounter _refCount;
+    ReferenceCounter<> _refCount;
+
+private:
+    /// Whether this node is registered in the unique table. Kept next to
+    /// the reference count, where it fits in the padding.
+    bool interned = false;
+
+protected:
+    /// Width of a ConstantExpr or InvalidKindExpr of at most 64 bits; 0
+    /// for other nodes and wider constants. Also fits in the padding.
+    std::uint8_t inlineWidth = 0;
 
 public:
-    unsigned hashValue;
+    std::uint64_t hashValue;
     Expr() { Expr::count++; }
 
-    virtual ~Expr() { Expr::count--; }
+    /// Nodes come from ExprAllocator's size-class slabs.
+    static void *operator new(std::size_t size) { return ExprAllocator::allocate(size); }
+    static void operator delete(void *p, std::size_t size) { ExprAllocator::deallocate(p, size); }
+
+    virtual ~Expr() {
+        if (interned)
+            evict();
+        Expr::count--;
+    }
 
     virtual Kind getKind() const = 0;
     virtual Width getWidth() const = 0;
@@ -73,6 +109,12 @@ public:
     virtual unsigned getNumKids() const = 0;
     virtual ref<Expr> getKid(unsigned i) const = 0;
 
+    /// The node of the same kind over \p kids, built with create() so the
+    /// result is simplified. Terminals have no kids and return themselves.
+    virtual ref<Expr> rebuild(ref<Expr> kids[]) const {
+        return ref<Expr>(const_cast<Expr *>(this));
+    }
+
     /// dump - Print the expression to stderr.
     void dump() const;
 
@@ -83,11 +125,15 @@ public:
     /// dump - Print the expression to stderr.
     // void dump() const;
       /// Returns the pre-computed hash of the current expression
-    virtual unsigned hash() const { return hashValue; }
+    std::uint64_t hash() const { return hashValue; }
 
     /// (Re)computes the hash of the current expression.
     /// Returns the hash value. 
-    virtual unsigned computeHash();
+    std::uint64_t computeHash();
+
+    /// Total order on expressions: 0 iff structurally equal, otherwise
+    /// ordered by kind, width, hash, contents and finally kids.
+    int compare(const Expr &b) const;
 
     /// isZero - Is this a constant zero.
     bool isZero() const;
@@ -100,11 +146,79 @@ public:
 
     static ref<Expr> createIsZero(ref<Expr> e);
 
+    /// Free \p e, whose last reference was dropped. Called by ref<Expr>.
+    ///
+    /// Nodes are queued on a per-thread list and deleted in a loop, so the
+    /// kids they release are queued too instead of being freed recursively:
+    /// dropping a deep chain neither overflows the stack nor recurses.
+    static void reclaim(Expr *e);
+
+    /// While enabled, reclaim() only queues nodes on the calling thread
+    /// and reclaimPending() frees them, so the interpreter loop decides
+    /// when to pay for destruction. Disabling frees everything queued.
+    static void setDeferredReclamation(bool enabled);
+
+    /// Free up to \p budget queued nodes on the calling thread, including
+    /// kids they release. Returns the number of nodes still queued.
+    static std::size_t reclaimPending(std::size_t budget = SIZE_MAX);
+
+    /// Return the canonical node for \p key, calling \p make to allocate
+    /// it if no live node with the same structure exists. Used by every
+    /// *Expr::alloc, so structurally equal expressions are pointer equal.
+    template <typename Make>
+    static ref<Expr> intern(const ExprKey &key, Make make);
+
+protected:
+    /// Compare the attributes of two nodes of the same kind, not counting
+    /// their kids.
+    virtual int compareContents(const Expr &b) const { return 0; }
+
+private:
+    static ref<Expr> internNode(const ExprKey &key, llvm::function_ref<Expr *()> make);
+    void evict();
+public:
+
     static void printKind(llvm::raw_ostream& os, Kind k);
     static void printWidth(llvm::raw_ostream& os, Width w);
 
 };
 
+/// Structural identity of an expression, as used by the unique table:
+/// kind, width, kids and the value or symbol of terminals. Kids and symbols
+/// are compared by pointer, which is exact because they are canonical
+/// themselves.
+struct ExprKey {
+    Expr::Kind kind;
+    Expr::Width width;
+    const Expr *kids[2] = {nullptr, nullptr};
+    /// Value of a constant of at most 64 bits, zero extended.
+    std::uint64_t bits = 0;
+    /// Value of a wider constant.
+    llvm::APInt value;
+    const Symbol *symbol = nullptr;
+
+    ExprKey(Expr::Kind k, Expr::Width w, const Expr *k0 = nullptr,
+            const Expr *k1 = nullptr)
+        : kind(k), width(w), kids{k0, k1} {}
+    ExprKey(Expr::Kind k, std::uint64_t v, Expr::Width w)
+        : kind(k), width(w), bits(v) {}
+    ExprKey(Expr::Kind k, const llvm::APInt &v)
+        : kind(k), width(v.getBitWidth()), value(v) {}
+    ExprKey(Expr::Kind k, const Symbol *s)
+        : kind(k), width(s->width), symbol(s) {}
+
+    /// The key of an existing node.
+    static ExprKey of(const Expr &e);
+
+    std::uint64_t hash() const;
+    bool operator==(const ExprKey &b) const;
+};
+
+template <typename Make>
+ref<Expr> Expr::intern(const ExprKey &key, Make make) {
+    return internNode(key, [&]() -> Expr * { return make(); });
+}
+
 class NonConstantExpr : public Expr {
 public:
     static bool classof(const Expr* e) {
@@ -114,10 +228,18 @@ public:
 };
 
 class BinaryExpr : public NonConstantExpr {
+    friend class LinearForm;
+
+    /// Linear form of an Add, Sub or Mul node, filled in on first use by
+    /// LinearForm::get.
+    mutable std::atomic<const LinearForm *> linearForm{nullptr};
+
 public:
     ref<Expr> left, right;
 
 public:
+    ~BinaryExpr();
+
     unsigned getNumKids() const { return 2; }
 
     ref<Expr> getKid(unsigned i) const {
@@ -163,9 +285,8 @@ public:
 
     public:  
     static ref<Expr> alloc(const ref<Expr> &e) {
-        ref<Expr> r(new NotExpr(e));
-        r->computeHash();
-        return r;
+        return Expr::intern(ExprKey(Not, e->getWidth(), e.get()),
+                            [&] { return new NotExpr(e); });
     }
     
     static ref<Expr> create(const ref<Expr> e);
@@ -180,8 +301,6 @@ public:
         return create(kids[0]);
     }
 
-    virtual unsigned computeHash();
-
     public:
     static bool classof(const Expr *E) {
         return E->getKind() == Expr::Not;
@@ -209,9 +328,8 @@ public:                                                                      \
     _class_kind##Expr(const ref<Expr> &l, const ref<Expr> &r)                  \
         : BinaryExpr(l, r) {}                                                  \
     static ref<Expr> alloc(const ref<Expr> &l, const ref<Expr> &r) {           \
-    ref<Expr> res(new _class_kind##Expr(l, r));                              \
-    res->computeHash();                                                      \
-    return res;                                                              \
+    return Expr::intern(ExprKey(_class_kind, l->getWidth(), l.get(), r.get()), \
+                        [&] { return new _class_kind##Expr(l, r); });          \
     }                                                                          \
     static ref<Expr> create(const ref<Expr> l, const ref<Expr> r);           \
     Width getWidth() const { return left->getWidth(); }                        \
@@ -247,9 +365,8 @@ public:                                                                      \
     _class_kind##Expr(const ref<Expr> &l, const ref<Expr> &r)                  \
         : CmpExpr(l, r) {}                                                     \
     static ref<Expr> alloc(const ref<Expr> &l, const ref<Expr> &r) {           \
-    ref<Expr> res(new _class_kind##Expr(l, r));                              \
-    res->computeHash();                                                      \
-    return res;                                                              \
+    return Expr::intern(ExprKey(_class_kind, Bool, l.get(), r.get()),          \
+                        [&] { return new _class_kind##Expr(l, r); });          \
     }                                                                          \
     static ref<Expr> create(const ref<Expr> l, const ref<Expr> r);           \
     Kind getKind() const { return _class_kind; }                               \
@@ -288,26 +405,63 @@ public:\
     static const unsigned numKids = 0;\
 \
 private:\
-    llvm::APInt value;\
-    _class_kind##Expr(const llvm::APInt &v) : value(v) {}\
+    /* Values of at most 64 bits are stored inline, zero extended, with */\
+    /* their width in Expr::inlineWidth; wider ones live in an APInt. */\
+    union {\
+        std::uint64_t bits;\
+        llvm::APInt *wide;\
+    };\
+\
+    _class_kind##Expr(std::uint64_t v, Width w) : bits(truncate(v, w)) {\
+        assert(w > 0 && w <= 64 && "Not an inline width");\
+        inlineWidth = w;\
+    }\
+    _class_kind##Expr(const llvm::APInt &v) : wide(new llvm::APInt(v)) {\
+        assert(v.getBitWidth() > 64 && "Use the inline constructor");\
+    }\
 \
 public:\
-    ~_class_kind##Expr() {}\
+    ~_class_kind##Expr() {\
+        if (isWide())\
+            delete wide;\
+    }\
+\
+    /* The low \p w bits of \p v. */\
+    static std::uint64_t truncate(std::uint64_t v, Width w) {\
+        return w >= 64 ? v : v & ((std::uint64_t(1) << w) - 1);\
+    }\
 \
-    Width getWidth() const { return value.getBitWidth(); }\
+    Width getWidth() const { return isWide() ? wide->getBitWidth() : inlineWidth; }\
     Kind getKind() const { return _class_kind; }\
 \
     unsigned getNumKids() const { return 0; }\
     ref<Expr> getKid(unsigned i) const { return 0; }\
 \
-    const llvm::APInt &getAPValue() const { return value; }\
+    /* Whether the value is wider than 64 bits and kept in an APInt. */\
+    bool isWide() const { return inlineWidth == 0; }\
+\
+    llvm::APInt getAPValue() const {\
+        return isWide() ? *wide : llvm::APInt(inlineWidth, bits);\
+    }\
+\
+    /* The value zero or sign extended to 64 bits; not for wide values. */\
+    std::uint64_t getZExtValue() const {\
+        assert(!isWide() && "Wide constant");\
+        return bits;\
+    }\
+    std::int64_t getSExtValue() const {\
+        assert(!isWide() && "Wide constant");\
+        return llvm::SignExtend64(bits, inlineWidth);\
+    }\
 \
-    virtual unsigned computeHash();\
+    /* Preallocated node for v if it is interned, null otherwise. */\
+    static _class_kind##Expr *getInterned(std::uint64_t v, Width w);\
 \
     static ref<_class_kind##Expr> alloc(const llvm::APInt &v) {\
-        ref<_class_kind##Expr> r(new _class_kind##Expr(v));\
-        r->computeHash();\
-        return r;\
+        if (v.getBitWidth() <= 64)\
+            return alloc(v.getZExtValue(), v.getBitWidth());\
+        return ref<_class_kind##Expr>(Expr::intern(ExprKey(_class_kind, v),\
+            [&] { return new _class_kind##Expr(v); }));\
     }\
 \
     static ref<_class_kind##Expr> alloc(const llvm::APFloat &f) {\
@@ -315,7 +469,13 @@ public:\
     }\
 \
     static ref<_class_kind##Expr> alloc(uint64_t v, Width w) {\
-        return alloc(llvm::APInt(w, v));\
+        if (w > 64)\
+            return alloc(llvm::APInt(w, v));\
+        v = truncate(v, w);\
+        if (_class_kind##Expr *interned = getInterned(v, w))\
+            return ref<_class_kind##Expr>::immortal(interned);\
+        return ref<_class_kind##Expr>(Expr::intern(ExprKey(_class_kind, v, w),\
+            [&] { return new _class_kind##Expr(v, w); }));\
     }\
 \
     static ref<_class_kind##Expr> create(uint64_t v, Width w) {\
@@ -325,21 +485,38 @@ public:\
     static bool classof(const Expr *E) { return E->getKind() == Expr::_class_kind; }\
     static bool classof(const _class_kind##Expr *) { return true; }\
 \
-    bool isZero() const { return getAPValue().isMinValue(); }\
+    bool isZero() const { return isWide() ? wide->isZero() : bits == 0; }\
+\
+    bool isOne() const { return isWide() ? wide->isOne() : bits == 1; }\
 \
     bool isTrue() const {\
-        return (getWidth() == Expr::Int32 && value.getSExtValue() != 0);\
+        return (getWidth() == Expr::Bool && bits);\
     }\
 \
     bool isFalse() const {\
-        return (getWidth() == Expr::Int32 && value.getSExtValue() == 0);\
+        return (getWidth() == Expr::Bool && !bits);\
     }\
 \
     bool isAllOnes() const {\
-        return getAPValue().isAllOnes();\
+        return isWide() ? wide->isAllOnes() : bits == truncate(~std::uint64_t(0), inlineWidth);\
     }\
 \
     ref<_class_kind##Expr> Not();\
+\
+protected:\
+    int compareContents(const Expr &b) const {\
+        const _class_kind##Expr &be = static_cast<const _class_kind##Expr &>(b);\
+        if (getWidth() != be.getWidth())\
+            return getWidth() < be.getWidth() ? -1 : 1;\
+        if (!isWide()) {\
+            if (bits == be.bits)\
+                return 0;\
+            return bits < be.bits ? -1 : 1;\
+        }\
+        if (*wide == *be.wide)\
+            return 0;\
+        return wide->ult(*be.wide) ? -1 : 1;\
+    }\
 };\
 
 TERMINAL_EXPR_CLASS(Constant)
@@ -351,9 +528,9 @@ public: static
     static const unsigned numKids = 0;
 
 private:
-    const std::string name;
+    const Symbol *symbol;
 
-    SymbolicExpr(std::string n): name(n) {}
+    SymbolicExpr(const Symbol *s): symbol(s) {}
 
     public: ~SymbolicExpr() {}
 
@@ -361,24 +538,28 @@ private:
     
     unsigned getNumKids() const { return 0; }
 
-    Width getWidth() const { return Int32; }
+    Width getWidth() const { return symbol->width; }
 
     ref <Expr> getKid(unsigned i) const {
         return 0;
     }
 
-    const std::string getName() const { return name; }
+    const Symbol *getSymbol() const { return symbol; }
 
-    virtual unsigned computeHash();
-    
-    static ref<SymbolicExpr> alloc(std::string n) {
-        ref <SymbolicExpr> r(new SymbolicExpr(n));
-        r -> computeHash();
-        return r;
+    const std::string &getName() const { return symbol->name; }
+
+    static ref<SymbolicExpr> alloc(const Symbol *s) {
+        return ref<SymbolicExpr>(Expr::intern(ExprKey(Symbolic, s),
+            [&] { return new SymbolicExpr(s); }));
+    }
+
+    static ref< SymbolicExpr > create(const Symbol *s) {
+        return alloc(s);
     }
 
-    static ref< SymbolicExpr > create(std::string n) {
-        return alloc(n);
+    /// The scalar Int32 symbol called \p n.
+    static ref< SymbolicExpr > create(const std::string &n) {
+        return alloc(SymbolTable::get(n));
     }
 
     static bool classof(const Expr * E) {
@@ -390,6 +571,14 @@ private:
     bool isZero() const { return false; }
     bool isTrue() const { return true; }
     bool isFalse() const { return false; }
+
+protected:
+    int compareContents(const Expr &b) const {
+        const Symbol *bs = static_cast<const SymbolicExpr &>(b).symbol;
+        // Order by name rather than id: ids depend on which worker saw
+        // a symbol first.
+        return symbol == bs ? 0 : symbol->name.compare(bs->name);
+    }
 };
 
 // Implementations
@@ -0,0 +1,37 @@
+#ifndef EXPRALLOCATOR_H
+#define EXPRALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace miniklee {
+
+/// Size-class slab allocator backing Expr::operator new/delete.
+///
+/// Requests are rounded up to a multiple of Granularity and served from
+/// per-size-class free lists. Each Expr subclass has a fixed size, so in
+/// practice every kind gets its own list. Lists are refilled by carving
+/// SlabSize chunks, which are never returned to the system, only recycled.
+/// Every thread has its own free lists; they are handed over to a shared
+/// pool when the thread exits. Requests larger than MaxSize go to the
+/// global operator new.
+class ExprAllocator {
+public:
+    static const std::size_t Granularity = 16;
+    static const std::size_t MaxSize = 128;
+    static const std::size_t NumClasses = MaxSize / Granularity;
+    static const std::size_t SlabSize = 64 * 1024;
+
+    static void *allocate(std::size_t size);
+    static void deallocate(void *p, std::size_t size);
+
+    /// Bytes currently handed out to live nodes, including rounding.
+    static std::uint64_t getLiveBytes();
+
+    /// Bytes obtained from the system for slabs and large nodes.
+    static std::uint64_t getReservedBytes();
+};
+
+} // namespace miniklee
+
+#endif // EXPRALLOCATOR_H
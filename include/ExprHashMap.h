@@ -0,0 +1,242 @@
+#ifndef EXPRHASHMAP_H
+#define EXPRHASHMAP_H
+
+#include "Expr.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace miniklee {
+
+namespace detail {
+/// Open-addressing hash table keyed on ref<Expr>, shared by ExprHashMap
+/// and ExprHashSet.
+///
+/// Linear probing over a power-of-two array of entries, using the hash
+/// cached in every node, so a lookup costs no hashing and usually one
+/// cache line. A null key marks an empty slot; erase shifts the following
+/// entries back instead of leaving tombstones. Keys match when they are
+/// the same node, or structurally equal (Expr::compare) for the rare
+/// nodes that are not hash-consed.
+///
+/// As with other open-addressing tables, inserting or erasing invalidates
+/// iterators and references.
+template <typename Entry, typename KeyOf>
+class ExprHashTable {
+public:
+    typedef Entry value_type;
+    typedef std::size_t size_type;
+
+    template <typename E>
+    class basic_iterator {
+        friend class ExprHashTable;
+        E *pos, *end;
+
+        basic_iterator(E *p, E *e) : pos(p), end(e) { skipEmpty(); }
+        void skipEmpty() {
+            while (pos != end && KeyOf::get(*pos).isNull())
+                ++pos;
+        }
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef E value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef E *pointer;
+        typedef E &reference;
+
+        basic_iterator() : pos(nullptr), end(nullptr) {}
+        /// iterator converts to const_iterator.
+        template <typename F>
+        basic_iterator(const basic_iterator<F> &it) : pos(it.pos), end(it.end) {}
+
+        E &operator*() const { return *pos; }
+        E *operator->() const { return pos; }
+        basic_iterator &operator++() {
+            ++pos;
+            skipEmpty();
+            return *this;
+        }
+        basic_iterator operator++(int) {
+            basic_iterator tmp(*this);
+            ++*this;
+            return tmp;
+        }
+        bool operator==(const basic_iterator &b) const { return pos == b.pos; }
+        bool operator!=(const basic_iterator &b) const { return pos != b.pos; }
+
+        template <typename> friend class basic_iterator;
+    };
+
+    typedef basic_iterator<Entry> iterator;
+    typedef basic_iterator<const Entry> const_iterator;
+
+    ExprHashTable() = default;
+
+    bool empty() const { return numEntries == 0; }
+    size_type size() const { return numEntries; }
+
+    iterator begin() { return iterator(slots.data(), slots.data() + slots.size()); }
+    iterator end() { return iterator(slots.data() + slots.size(), slots.data() + slots.size()); }
+    const_iterator begin() const {
+        return const_iterator(slots.data(), slots.data() + slots.size());
+    }
+    const_iterator end() const {
+        return const_iterator(slots.data() + slots.size(), slots.data() + slots.size());
+    }
+
+    void clear() {
+        slots.clear();
+        numEntries = 0;
+    }
+
+    /// Make room for \p n entries without rehashing.
+    void reserve(size_type n) {
+        size_type capacity = MinCapacity;
+        while (capacity * MaxLoadNum < n * MaxLoadDen)
+            capacity *= 2;
+        if (capacity > slots.size())
+            rehash(capacity);
+    }
+
+    iterator find(const ref<Expr> &key) {
+        if (slots.empty())
+            return end();
+        std::size_t i = probe(key);
+        if (KeyOf::get(slots[i]).isNull())
+            return end();
+        return iterator(slots.data() + i, slots.data() + slots.size());
+    }
+    const_iterator find(const ref<Expr> &key) const {
+        return const_cast<ExprHashTable *>(this)->find(key);
+    }
+
+    size_type count(const ref<Expr> &key) const { return find(key) != end(); }
+
+    std::pair<iterator, bool> insert(const Entry &entry) { return emplace(Entry(entry)); }
+
+    std::pair<iterator, bool> insert(Entry &&entry) { return emplace(std::move(entry)); }
+
+    size_type erase(const ref<Expr> &key) {
+        iterator it = find(key);
+        if (it == end())
+            return 0;
+        erase(it);
+        return 1;
+    }
+
+    /// Remove the entry at \p it and shift back the entries after it in
+    /// its probe run, so lookups never need tombstones.
+    void erase(iterator it) {
+        std::size_t mask = slots.size() - 1;
+        std::size_t hole = it.pos - slots.data();
+        std::size_t i = hole;
+        for (;;) {
+            i = (i + 1) & mask;
+            const ref<Expr> &key = KeyOf::get(slots[i]);
+            if (key.isNull())
+                break;
+            // Move the entry into the hole unless its home slot lies
+            // cyclically in (hole, i].
+            std::size_t home = key->hash() & mask;
+            if (((i - home) & mask) >= ((i - hole) & mask)) {
+                slots[hole] = std::move(slots[i]);
+                hole = i;
+            }
+        }
+        slots[hole] = Entry();
+        --numEntries;
+    }
+
+protected:
+    /// Probe for \p key; returns its slot, or the empty slot ending its
+    /// probe run. Requires a non-empty table.
+    std::size_t probe(const ref<Expr> &key) const {
+        std::size_t mask = slots.size() - 1;
+        std::uint64_t h = key->hash();
+        for (std::size_t i = h & mask;; i = (i + 1) & mask) {
+            const ref<Expr> &k = KeyOf::get(slots[i]);
+            if (k.isNull())
+                return i;
+            if (k.get() == key.get() ||
+                (k->hash() == h && k->compare(*key) == 0))
+                return i;
+        }
+    }
+
+    std::pair<iterator, bool> emplace(Entry &&entry) {
+        if ((numEntries + 1) * MaxLoadDen > slots.size() * MaxLoadNum)
+            rehash(slots.empty() ? MinCapacity : slots.size() * 2);
+
+        std::size_t i = probe(KeyOf::get(entry));
+        Entry *end = slots.data() + slots.size();
+        if (!KeyOf::get(slots[i]).isNull())
+            return std::make_pair(iterator(slots.data() + i, end), false);
+        slots[i] = std::move(entry);
+        ++numEntries;
+        return std::make_pair(iterator(slots.data() + i, end), true);
+    }
+
+private:
+    static const size_type MinCapacity = 16;
+    /// Grow beyond a 3/4 load factor.
+    static const size_type MaxLoadNum = 3;
+    static const size_type MaxLoadDen = 4;
+
+    std::vector<Entry> slots;
+    size_type numEntries = 0;
+
+    void rehash(size_type capacity) {
+        std::vector<Entry> old(capacity);
+        old.swap(slots);
+        std::size_t mask = capacity - 1;
+        for (Entry &e : old) {
+            const ref<Expr> &key = KeyOf::get(e);
+            if (key.isNull())
+                continue;
+            std::size_t i = key->hash() & mask;
+            while (!KeyOf::get(slots[i]).isNull())
+                i = (i + 1) & mask;
+            slots[i] = std::move(e);
+        }
+    }
+};
+
+template <typename T>
+struct KeyOfPair {
+    static const ref<Expr> &get(const std::pair<ref<Expr>, T> &e) { return e.first; }
+};
+
+struct KeyOfSelf {
+    static const ref<Expr> &get(const ref<Expr> &e) { return e; }
+};
+} // namespace detail
+
+/// Map from expressions to \p T. Entries are std::pair<ref<Expr>, T>; the
+/// key must not be modified through an iterator.
+template <typename T>
+class ExprHashMap
+    : public detail::ExprHashTable<std::pair<ref<Expr>, T>, detail::KeyOfPair<T>> {
+public:
+    typedef ref<Expr> key_type;
+    typedef T mapped_type;
+
+    T &operator[](const ref<Expr> &key) {
+        auto it = this->find(key);
+        if (it != this->end())
+            return it->second;
+        return this->emplace(std::make_pair(key, T())).first->second;
+    }
+};
+
+class ExprHashSet : public detail::ExprHashTable<ref<Expr>, detail::KeyOfSelf> {
+public:
+    typedef ref<Expr> key_type;
+};
+
+} // namespace miniklee
+
+#endif // EXPRHASHMAP_H
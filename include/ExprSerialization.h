@@ -0,0 +1,106 @@
+#ifndef EXPRSERIALIZATION_H
+#define EXPRSERIALIZATION_H
+
+#include "Expr.h"
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Binary format for expression DAGs and queries.
+///
+///   stream  := "MKEX" version:uleb record*
+///   record  := node | root
+///   node    := tag:u8 payload          ; tag = NodeTagBase + kind + 2
+///     Constant, InvalidKind: width:uleb word:uleb*   ; (width + 63) / 64 words
+///     Symbolic:              length:uleb bytes width:uleb size:uleb
+///     Not:                   kid
+///     binary kinds:          kid kid
+///   kid     := uleb                    ; distance back to an earlier node id
+///   root    := ExprTag id:uleb
+///            | QueryTag count:uleb id:uleb* id:uleb ; constraints, oldest first, then expr
+///
+/// Nodes are numbered in stream order and each is written once, before its
+/// first use, so a stream of many queries over one path stores the shared
+/// prefix once. Widths of non-terminal nodes follow from their kids.
+
+namespace miniklee {
+
+class ConstraintSet;
+struct Query;
+
+namespace serialization {
+static const char Magic[4] = {'M', 'K', 'E', 'X'};
+static const std::uint64_t Version = 2;
+
+enum Tag : std::uint8_t {
+    ExprTag = 0,
+    QueryTag = 1,
+    NodeTagBase = 2
+};
+} // namespace serialization
+
+/// Streams expressions and queries to \p os. Nodes already written are
+/// referenced rather than repeated, for the lifetime of the writer, which
+/// keeps them alive.
+class ExprWriter {
+    llvm::raw_ostream &os;
+    std::unordered_map<const Expr *, std::uint64_t> ids;
+    std::vector<ref<Expr>> written;
+
+    std::uint64_t writeNode(const ref<Expr> &e);
+
+public:
+    explicit ExprWriter(llvm::raw_ostream &os);
+
+    void write(const ref<Expr> &e);
+    void write(const Query &query);
+
+    /// Number of distinct nodes written so far.
+    std::uint64_t getNumNodes() const { return written.size(); }
+};
+
+/// Reads a stream produced by ExprWriter directly from \p buffer, which
+/// may be a memory-mapped file and must outlive the reader. Nodes are
+/// rebuilt with the alloc functions, so the structure is reproduced
+/// exactly and shared with any equal live expression.
+class ExprReader {
+public:
+    struct Record {
+        enum Kind { ExprRecord, QueryRecord } kind;
+        /// For a query, the constraints, oldest first, followed by the
+        /// query expression.
+        std::vector<ref<Expr>> exprs;
+    };
+
+    explicit ExprReader(llvm::StringRef buffer);
+
+    /// Read the next root record. Returns false at the end of the stream
+    /// or on malformed input; getError() tells them apart.
+    bool next(Record &record);
+
+    const std::string &getError() const { return error; }
+
+    /// Constraint set holding the constraints of a query record.
+    static ConstraintSet getConstraints(const Record &record);
+
+private:
+    const std::uint8_t *pos;
+    const std::uint8_t *end;
+    std::vector<ref<Expr>> nodes;
+    std::string error;
+
+    bool fail(const std::string &message);
+    bool readULEB(std::uint64_t &value);
+    bool readId(std::uint64_t &id);
+    bool readKid(ref<Expr> &kid);
+    bool readNode(std::uint8_t tag);
+};
+
+} // namespace miniklee
+
+#endif // EXPRSERIALIZATION_H
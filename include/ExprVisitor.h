@@ -0,0 +1,157 @@
+#ifndef EXPRVISITOR_H
+#define EXPRVISITOR_H
+
+#include "Expr.h"
+#include "ExprHashMap.h"
+
+#include <utility>
+#include <vector>
+
+namespace miniklee {
+
+/// Walks every distinct node reachable from one or more roots exactly
+/// once, however often it is shared.
+///
+/// Derived classes hide visitPre and/or visitPost with public members
+/// (CRTP, no virtual calls). visitPre runs when a node is first reached and may skip its
+/// kids; visitPost runs after all of its kids have been visited. Either
+/// may stop the whole traversal. The walk uses an explicit stack, so path
+/// conditions deeper than the call stack are fine.
+///
+/// The visited set persists across visit() calls until reset(), so
+/// several roots can be walked as one DAG.
+template <typename Derived>
+class ExprVisitor {
+public:
+    enum Action {
+        /// Visit the kids, then call visitPost.
+        Continue,
+        /// Do not visit the kids, nor call visitPost on this node.
+        SkipKids,
+        /// Abandon the traversal.
+        Stop
+    };
+
+    /// Visit the nodes under \p root not visited yet. Returns false if
+    /// the traversal was stopped.
+    bool visit(const ref<Expr> &root) {
+        std::vector<std::pair<ref<Expr>, bool>> stack;
+        stack.emplace_back(root, false);
+        while (!stack.empty()) {
+            if (stack.back().second) {
+                ref<Expr> e = std::move(stack.back().first);
+                stack.pop_back();
+                if (derived().visitPost(*e) == Stop)
+                    return false;
+                continue;
+            }
+
+            const ref<Expr> &e = stack.back().first;
+            if (!visited.insert(e).second) {
+                stack.pop_back();
+                continue;
+            }
+            Action action = derived().visitPre(*e);
+            if (action == Stop)
+                return false;
+            if (action == SkipKids) {
+                stack.pop_back();
+                continue;
+            }
+            stack.back().second = true;
+            ref<Expr> node = e;
+            // Pushed in reverse so kids are visited left to right.
+            for (unsigned i = node->getNumKids(); i-- > 0;)
+                stack.emplace_back(node->getKid(i), false);
+        }
+        return true;
+    }
+
+    /// Forget which nodes were visited.
+    void reset() { visited.clear(); }
+
+protected:
+    Action visitPre(const Expr &) { return Continue; }
+    Action visitPost(const Expr &) { return Continue; }
+
+private:
+    ExprHashSet visited;
+
+    Derived &derived() { return static_cast<Derived &>(*this); }
+};
+
+/// Rebuilds expressions bottom up, rewriting each distinct node once.
+///
+/// Derived classes hide rewritePre and/or rewritePost with public members
+/// (CRTP).
+/// rewritePre may replace a node outright, without looking at its kids,
+/// by returning a non-null expression. Otherwise the kids are rewritten
+/// first and rewritePost gets the node with its rewritten kids; the
+/// default rebuilds the node through create() if any kid changed, which
+/// re-simplifies it.
+///
+/// Results are memoized across rewrite() calls until reset(), so rewriting
+/// every constraint of a path shares the work on common subterms.
+template <typename Derived>
+class ExprRewriter {
+public:
+    ref<Expr> rewrite(const ref<Expr> &root) {
+        auto it = memo.find(root);
+        if (it != memo.end())
+            return it->second;
+
+        std::vector<std::pair<ref<Expr>, bool>> stack;
+        stack.emplace_back(root, false);
+        while (!stack.empty()) {
+            if (stack.back().second) {
+                ref<Expr> e = std::move(stack.back().first);
+                stack.pop_back();
+                ref<Expr> kids[2];
+                for (unsigned i = 0; i < e->getNumKids(); ++i)
+                    kids[i] = memo.find(e->getKid(i))->second;
+                ref<Expr> result = derived().rewritePost(e, kids);
+                memo.insert(std::make_pair(e, result));
+                continue;
+            }
+
+            const ref<Expr> &e = stack.back().first;
+            if (memo.count(e)) {
+                stack.pop_back();
+                continue;
+            }
+            ref<Expr> replacement = derived().rewritePre(e);
+            if (!replacement.isNull()) {
+                memo.insert(std::make_pair(e, replacement));
+                stack.pop_back();
+                continue;
+            }
+            stack.back().second = true;
+            ref<Expr> node = e;
+            for (unsigned i = node->getNumKids(); i-- > 0;)
+                stack.emplace_back(node->getKid(i), false);
+        }
+        return memo.find(root)->second;
+    }
+
+    /// Forget the memoized results.
+    void reset() { memo.clear(); }
+
+protected:
+    ref<Expr> rewritePre(const ref<Expr> &) { return ref<Expr>(); }
+
+    ref<Expr> rewritePost(const ref<Expr> &e, ref<Expr> kids[]) {
+        for (unsigned i = 0; i < e->getNumKids(); ++i)
+            if (kids[i].get() != e->getKid(i).get())
+                return e->rebuild(kids);
+        return e;
+    }
+
+private:
+    ExprHashMap<ref<Expr>> memo;
+
+    Derived &derived() { return static_cast<Derived &>(*this); }
+};
+
+} // namespace miniklee
+
+#endif // EXPRVISITOR_H
@@ -0,0 +1,103 @@
+#ifndef KMODULE_H
+#define KMODULE_H
+
+#include <llvm/IR/Function.h>
+#include <llvm/IR/Instruction.h>
+#include <llvm/IR/Module.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Expr.h"
+
+using namespace miniklee;
+
+struct KFunction;
+
+/// Pre-decoded form of a single llvm::Instruction.
+///
+/// Operands are encoded as integers: a non-negative value is a register
+/// slot in the owning KFunction, a negative value -(i + 1) names entry i of
+/// KFunction::constants. Successors are indices into
+/// KFunction::instructions, so a branch never walks the CFG at run time.
+struct KInstruction {
+    static const unsigned MaxOperands = 2;
+    static const unsigned NoRegister = ~0u;
+
+    /// The LLVM opcode, cached to avoid the virtual dispatch of the IR.
+    unsigned opcode;
+
+    /// ICmpInst predicate, only meaningful for ICmp.
+    unsigned predicate;
+
+    /// Register written by this instruction, NoRegister if none.
+    unsigned dest;
+
+    unsigned numOperands;
+    int operands[MaxOperands];
+
+    /// Resolved branch targets. A conditional Br uses both, an
+    /// unconditional one only the first.
+    unsigned numSuccessors;
+    unsigned successors[2];
+
+    /// Index into KFunction::symbolNames for make_symbolic calls.
+    unsigned symbolName;
+
+    /// The original instruction, kept for diagnostics.
+    llvm::Instruction *inst;
+
+    static bool isConstantOperand(int op) { return op < 0; }
+    static unsigned constantIndex(int op) { return -op - 1; }
+};
+
+typedef const KInstruction *KInstIterator;
+
+struct KFunction {
+    llvm::Function *function;
+
+    /// Number of register slots used by the function.
+    unsigned numRegisters;
+
+    /// Decoded instructions, laid out block after block in IR order.
+    /// Debug intrinsics are dropped.
+    std::vector<KInstruction> instructions;
+
+    /// Pre-materialized constant operands.
+    std::vector<ref<Expr>> constants;
+
+    /// Names passed to make_symbolic, indexed by KInstruction::symbolName.
+    std::vector<std::string> symbolNames;
+
+    explicit KFunction(llvm::Function *f);
+
+    KFunction(const KFunction &) = delete;
+    KFunction &operator=(const KFunction &) = delete;
+
+    KInstIterator entry() const { return instructions.data(); }
+    KInstIterator at(unsigned index) const { return &instructions[index]; }
+
+private:
+    std::unordered_map<const llvm::Value *, unsigned> registerMap;
+    std::unordered_map<const llvm::Value *, unsigned> constantMap;
+
+    int getOperandNum(llvm::Value *v);
+    void decode(llvm::Instruction *i, KInstruction &ki);
+};
+
+/// Owns the decoded functions of a module. Functions are translated once,
+/// on first use.
+class KModule {
+public:
+    llvm::Module *module;
+
+    explicit KModule(llvm::Module *m) : module(m) {}
+
+    KFunction *getKFunction(llvm::Function *f);
+
+private:
+    std::unordered_map<llvm::Function *, std::unique_ptr<KFunction>> functionMap;
+};
+
+#endif // KMODULE_H
@@ -0,0 +1,69 @@
+#ifndef LINEARFORM_H
+#define LINEARFORM_H
+
+#include "Expr.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace miniklee {
+
+/// A linear combination of symbols, c + k1 * x1 + ... + kn * xn, with
+/// arithmetic modulo 2^width.
+///
+/// Expressions built only from constants, symbols, Add, Sub and Mul by a
+/// constant, at most 64 bits wide, are linear. Add, Sub and Mul nodes
+/// compute their form on first use and keep it (see get()), so analysing
+/// a linear constraint costs O(#symbols) however long the chain that
+/// built it. AddExpr, SubExpr and MulExpr::create use the combined form
+/// of their operands to collapse such chains into one canonical sum.
+class LinearForm {
+public:
+    struct Term {
+        const Symbol *symbol;
+        std::uint64_t coefficient;
+    };
+
+    Expr::Width width;
+    std::uint64_t constant = 0;
+    /// Sorted by symbol id, with nonzero coefficients.
+    std::vector<Term> terms;
+
+    explicit LinearForm(Expr::Width w) : width(w) {}
+
+    /// Add \p scale times the linear form of \p e. Returns false, leaving
+    /// this form unspecified, if \p e is not linear.
+    bool add(const Expr *e, std::uint64_t scale = 1);
+
+    /// The constant term, sign extended from the form's width.
+    std::int64_t getSignedConstant() const;
+
+    /// The canonical expression for this form: c + (k1 * x1 + (k2 * x2
+    /// + ...)), in symbol id order, where unit coefficients and a zero
+    /// constant are left out.
+    ref<Expr> toExpr() const;
+
+    /// The cached form of an Add, Sub or Mul node, computed on first use,
+    /// or null if the node is not linear.
+    static const LinearForm *get(const BinaryExpr *e);
+
+    /// The canonical sum for \p l (kind) \p r, where \p kind is Add, Sub
+    /// or Mul, or null if the result would not be linear.
+    static ref<Expr> combine(Expr::Kind kind, const ref<Expr> &l, const ref<Expr> &r);
+
+private:
+    std::uint64_t mask() const {
+        return width >= 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << width) - 1;
+    }
+
+    void addTerm(const Symbol *symbol, std::uint64_t coefficient);
+    void addScaled(const LinearForm &f, std::uint64_t scale);
+    /// Add l (kind) r, for kind Add, Sub or Mul by a constant.
+    bool addOperation(Expr::Kind kind, const Expr *l, const Expr *r);
+
+    static const LinearForm *compute(const BinaryExpr *e);
+};
+
+} // namespace miniklee
+
+#endif // LINEARFORM_H
@@ -1,11 +1,12 @@
 #ifndef REF_H
 #define REF_H
 
-template<class T>
-class ref;
-
 #include "llvm/Support/Casting.h"
 
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+
 using llvm::cast;
 using llvm::cast_or_null;
 using llvm::dyn_cast;
@@ -13,13 +14,71 @@ using llvm::dyn_cast_or_null;
 using llvm::isa;
 using llvm::isa_and_nonnull;
 
+/// Reference counting policies for ReferenceCounter and ref.
+
+/// Counts updated with atomic read-modify-write instructions, so objects
+/// can be shared between threads.
+struct AtomicRefCount {
+    typedef std::atomic<unsigned> Counter;
+    static const bool ThreadSafe = true;
+
+    static unsigned load(const Counter &c) { return c.load(std::memory_order_acquire); }
+    static void reset(Counter &c) { c.store(0, std::memory_order_relaxed); }
+    static void increment(Counter &c) { c.fetch_add(1, std::memory_order_relaxed); }
+    /// Returns true if this dropped the last reference.
+    static bool decrement(Counter &c) {
+        return c.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+    /// Increment unless the count is zero; returns whether it did.
+    static bool tryIncrement(Counter &c) {
+        unsigned n = c.load(std::memory_order_relaxed);
+        do {
+            if (n == 0)
+                return false;
+        } while (!c.compare_exchange_weak(n, n + 1, std::memory_order_acquire,
+                                          std::memory_order_relaxed));
+        return true;
+    }
+};
+
+/// Counts updated with plain loads and stores. Cheaper, but objects must
+/// not be shared between threads.
+struct PlainRefCount {
+    typedef unsigned Counter;
+    static const bool ThreadSafe = false;
+
+    static unsigned load(const Counter &c) { return c; }
+    static void reset(Counter &c) { c = 0; }
+    static void increment(Counter &c) { ++c; }
+    static bool decrement(Counter &c) { return --c == 0; }
+    static bool tryIncrement(Counter &c) {
+        if (c == 0)
+            return false;
+        ++c;
+        return true;
+    }
+};
+
+/// Policy used by ReferenceCounter<> and ref<T>. Atomic unless built with
+/// MINIKLEE_REFCOUNT_PLAIN (make REFCOUNT=plain), which only supports a
+/// single worker.
+#ifdef MINIKLEE_REFCOUNT_PLAIN
+typedef PlainRefCount DefaultRefCountPolicy;
+#else
+typedef AtomicRefCount DefaultRefCountPolicy;
+#endif
+
+template <class T, class Policy = DefaultRefCountPolicy>
+class ref;
+
 /// Reference counter to be used as part of a ref-managed struct or class
+template <class Policy = DefaultRefCountPolicy>
 class ReferenceCounter {
-    template<class T>
+    template <class T, class P>
     friend class ref;
 
     /// Count how often the object has been referenced.
-    unsigned refCount = 0;
+    typename Policy::Counter refCount{0};
 
     public:
     ReferenceCounter() = default;
@@ -32,14 +91,18 @@ class ReferenceCounter {
 
     /// Returns the number of parallel references of this objects
     /// \return number of references on this object
-    unsigned getCount() {return refCount;}
+    unsigned getCount() const { return Policy::load(refCount); }
+
+    /// Take a reference that is never released, keeping the object alive
+    /// for the rest of the program. Required before ref<T>::immortal().
+    void pin() { Policy::increment(refCount); }
 
     // Copy assignment operator
     ReferenceCounter &operator=(const ReferenceCounter &a) {
         if (this == &a)
         return *this;
         // The new copy won't be referenced
-        refCount = 0;
+        Policy::reset(refCount);
         return *this;
     }
 
@@ -49,31 +112,83 @@ class ReferenceCounter {
     ReferenceCounter &operator=(ReferenceCounter &&other) noexcept = delete;
 };
 
+namespace ref_detail {
+/// Free an object whose last reference was dropped: through T::reclaim
+/// if the class provides one, otherwise with delete.
 template <class T>
+auto reclaim(T *p, int) -> decltype(T::reclaim(p), void()) { T::reclaim(p); }
+
+template <class T>
+void reclaim(T *p, long) { delete p; }
+} // namespace ref_detail
+
+/// Counted reference to a T holding a ReferenceCounter<Policy> named
+/// _refCount.
+template <class T, class Policy>
 class ref
 {
+    /// The referenced object. The low bit tags immortal objects (see
+    /// immortal()), whose reference count is never touched.
     T *ptr;
 
+    static const std::uintptr_t ImmortalTag = 1;
+
+    static T *untag(T *p) {
+        return reinterpret_cast<T *>(reinterpret_cast<std::uintptr_t>(p) & ~ImmortalTag);
+    }
+
+    static T *tag(T *p, bool immortal) {
+        return immortal ? reinterpret_cast<T *>(reinterpret_cast<std::uintptr_t>(p) | ImmortalTag)
+                        : p;
+    }
+
+    bool isImmortal() const {
+        return reinterpret_cast<std::uintptr_t>(ptr) & ImmortalTag;
+    }
+
 public:
     // default constructor: create a NULL reference
     ref() : ptr(nullptr) {}
     ~ref() { dec(); }
 
+    /// Reference an object that lives for the rest of the program, such as
+    /// an interned constant. Copying or destroying the reference is free:
+    /// it neither reads nor writes the object's reference count. The object
+    /// must hold one reference of its own so it is never deleted through a
+    /// plain pointer.
+    static ref immortal(T *p) {
+        assert(p && p->_refCount.getCount() > 0 && "Immortal object not pinned");
+        ref r;
+        r.ptr = tag(p, true);
+        return r;
+    }
+
+    /// Take a new reference to \p p unless its count already dropped to
+    /// zero, i.e. it is being destroyed; returns a null ref in that case.
+    /// Lets a lookup table hand out nodes that die concurrently.
+    static ref tryAcquire(T *p) {
+        if (!Policy::tryIncrement(p->_refCount.refCount))
+            return ref();
+        ref r;
+        r.ptr = p;
+        return r;
+    }
+
 private:
     void inc() const
     {
-        if (ptr)
-            ++ptr->_refCount.refCount;
+        if (ptr && !isImmortal())
+            Policy::increment(ptr->_refCount.refCount);
     }
 
     void dec() const
     {
-        if (ptr && --ptr->_refCount.refCount == 0)
-            delete ptr;
+        if (ptr && !isImmortal() && Policy::decrement(ptr->_refCount.refCount))
+            ref_detail::reclaim(ptr, 0);
     }
 
 public:
-    template <class U>
+    template <class U, class P>
     friend class ref;
 
     // constructor from pointer
@@ -83,24 +198,24 @@ public:
     }
 
     // normal copy constructor
-    ref(const ref<T> &r) : ptr(r.ptr)
+    ref(const ref &r) : ptr(r.ptr)
     {
         inc();
     }
 
     // conversion constructor
     template <class U>
-    ref(const ref<U> &r) : ptr(r.ptr)
+    ref(const ref<U, Policy> &r) : ptr(tag(r.get(), r.isImmortal()))
     {
         inc();
     }
 
     // normal move constructor: invoke the move assignment operator
-    ref(ref<T> &&r) noexcept : ptr(nullptr) { *this = std::move(r); }
+    ref(ref &&r) noexcept : ptr(nullptr) { *this = std::move(r); }
 
     // conversion move constructors: invoke the move assignment operator
     template <class U>
-    ref(ref<U> &&r) noexcept : ptr(nullptr)
+    ref(ref<U, Policy> &&r) noexcept : ptr(nullptr)
     {
         *this = std::move(r);
     }
@@ -108,12 +223,12 @@ public:
     // pointer operations
     T *get() const
     {
-        return ptr;
+        return untag(ptr);
     }
 
     /* The copy assignment operator must also explicitly be defined,
      * despite a redundant template. */
-    ref<T> &operator=(const ref<T> &r)
+    ref &operator=(const ref &r)
     {
         r.inc();
         // Create a copy of the pointer as the
@@ -135,7 +250,7 @@ public:
     }
 
     template <class U>
-    ref<T> &operator=(const ref<U> &r)
+    ref &operator=(const ref<U, Policy> &r)
     {
         r.inc();
         // Create a copy of the pointer as the currently
@@ -150,7 +265,7 @@ public:
         //    root = root->next;
         // ````````````````````````
 
-        U *saved_ptr = r.ptr;
+        T *saved_ptr = tag(r.get(), r.isImmortal());
         dec();
         ptr = saved_ptr;
 
@@ -158,7 +273,7 @@ public:
     }
 
     // Move assignment operator
-    ref<T> &operator=(ref<T> &&r) noexcept
+    ref &operator=(ref &&r) noexcept
     {
         if (this == &r)
             return *this;
@@ -170,7 +285,7 @@ public:
 
     // Move assignment operator
     template <class U>
-    ref<T> &operator=(ref<U> &&r) noexcept
+    ref &operator=(ref<U, Policy> &&r) noexcept
     {
         if (static_cast<void *>(this) == static_cast<void *>(&r))
             return *this;
@@ -179,8 +294,8 @@ public:
         // Decrement local counter to not hold reference anymore
         dec();
 
-        // Assign to this ref
-        ptr = cast_or_null<T>(r.ptr);
+        // Assign to this ref, keeping the immortal tag
+        ptr = tag(cast_or_null<T>(r.get()), r.isImmortal());
 
         // Invalidate old ptr
         r.ptr = nullptr;
@@ -191,12 +306,12 @@ public:
 
     T &operator*() const
     {
-        return *ptr;
+        return *get();
     }
 
     T *operator->() const
     {
-        return ptr;
+        return get();
     }
 
     bool isNull() const { return ptr == nullptr; }
@@ -0,0 +1,68 @@
+#ifndef REGISTERFILE_H
+#define REGISTERFILE_H
+
+#include <vector>
+
+#include "Expr.h"
+
+using namespace miniklee;
+
+/// Copy-on-write register file of an ExecutionState.
+///
+/// Registers are grouped in fixed-size pages reached through a page table.
+/// Copying a RegisterFile only bumps the reference count of the table, and
+/// a write clones the table and the touched page only while they are still
+/// shared with another state. Sibling states therefore share every page
+/// neither of them has written since the fork.
+class RegisterFile {
+    static const unsigned PageBits = 4;
+    static const unsigned PageSize = 1u << PageBits;
+    static const unsigned PageMask = PageSize - 1;
+
+    struct Page {
+        ReferenceCounter<> _refCount;
+        ref<Expr> slots[PageSize];
+    };
+
+    struct Table {
+        ReferenceCounter<> _refCount;
+        std::vector<ref<Page>> pages;
+    };
+
+    ref<Table> table;
+    unsigned numRegisters = 0;
+
+public:
+    RegisterFile() = default;
+
+    explicit RegisterFile(unsigned n) : table(new Table()), numRegisters(n) {
+        table->pages.resize((n + PageMask) >> PageBits);
+    }
+
+    unsigned size() const { return numRegisters; }
+
+    /// Read register \p r. Registers never written read as a null ref.
+    const ref<Expr> &operator[](unsigned r) const {
+        static const ref<Expr> unset;
+        assert(r < numRegisters && "Invalid register");
+        const ref<Page> &page = table->pages[r >> PageBits];
+        return page ? page->slots[r & PageMask] : unset;
+    }
+
+    /// Write register \p r, unsharing the table and the page on demand.
+    void set(unsigned r, ref<Expr> value) {
+        assert(r < numRegisters && "Invalid register");
+        if (table->_refCount.getCount() > 1)
+            table = new Table(*table);
+
+        ref<Page> &page = table->pages[r >> PageBits];
+        if (page.isNull())
+            page = new Page();
+        else if (page->_refCount.getCount() > 1)
+            page = new Page(*page);
+
+        page->slots[r & PageMask] = std::move(value);
+    }
+};
+
+#endif // REGISTERFILE_H
@@ -0,0 +1,161 @@
+#ifndef SEARCHER_H
+#define SEARCHER_H
+
+#include "llvm/Support/raw_ostream.h"
+
+#include <list>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+class ExecutionState;
+
+/// A Searcher decides which state the executor steps next. It is told about
+/// every state that is added or removed after each instruction, and every
+/// implementation supports removing an arbitrary state in O(1) or O(log n).
+class Searcher {
+public:
+    virtual ~Searcher() = default;
+
+    /// Select the state to execute next. Must not be called when empty().
+    virtual ExecutionState &selectState() = 0;
+
+    /// Notify the searcher of the states added and removed while executing
+    /// \p current, which is null on the very first update.
+    virtual void update(ExecutionState *current,
+                        const std::vector<ExecutionState *> &addedStates,
+                        const std::vector<ExecutionState *> &removedStates) = 0;
+
+    virtual bool empty() = 0;
+
+    virtual void printName(llvm::raw_ostream &os) = 0;
+};
+
+enum class SearcherType {
+    DFS,
+    BFS,
+    RandomState,
+    NURS_Depth,
+    NURS_RP
+};
+
+/// DFSSearcher - always continue with the most recently added state.
+class DFSSearcher final : public Searcher {
+    std::list<ExecutionState *> states;
+    std::unordered_map<ExecutionState *, std::list<ExecutionState *>::iterator> positions;
+
+public:
+    ExecutionState &selectState() override;
+    void update(ExecutionState *current,
+                const std::vector<ExecutionState *> &addedStates,
+                const std::vector<ExecutionState *> &removedStates) override;
+    bool empty() override { return states.empty(); }
+    void printName(llvm::raw_ostream &os) override { os << "DFSSearcher\n"; }
+};
+
+/// BFSSearcher - run the oldest state; a state that forks goes to the back
+/// of the queue together with its children.
+class BFSSearcher final : public Searcher {
+    std::list<ExecutionState *> states;
+    std::unordered_map<ExecutionState *, std::list<ExecutionState *>::iterator> positions;
+
+public:
+    ExecutionState &selectState() override;
+    void update(ExecutionState *current,
+                const std::vector<ExecutionState *> &addedStates,
+                const std::vector<ExecutionState *> &removedStates) override;
+    bool empty() override { return states.empty(); }
+    void printName(llvm::raw_ostream &os) override { os << "BFSSearcher\n"; }
+};
+
+/// RandomSearcher - pick a state uniformly at random.
+class RandomSearcher final : public Searcher {
+    std::vector<ExecutionState *> states;
+    std::unordered_map<ExecutionState *, size_t> positions;
+    std::mt19937 &rng;
+
+public:
+    explicit RandomSearcher(std::mt19937 &rng) : rng(rng) {}
+
+    ExecutionState &selectState() override;
+    void update(ExecutionState *current,
+                const std::vector<ExecutionState *> &addedStates,
+                const std::vector<ExecutionState *> &removedStates) override;
+    bool empty() override { return states.empty(); }
+    void printName(llvm::raw_ostream &os) override { os << "RandomSearcher\n"; }
+};
+
+/// DiscretePDF - a set of weighted items supporting insertion, removal,
+/// reweighting and weighted sampling in O(log n). Weights live in a Fenwick
+/// tree over slots; freed slots are recycled.
+class DiscretePDF {
+    std::vector<ExecutionState *> items;
+    std::vector<double> weights;
+    std::vector<double> tree;
+    std::vector<size_t> freeSlots;
+    std::unordered_map<ExecutionState *, size_t> slots;
+
+    void add(size_t slot, double delta);
+    void grow();
+
+public:
+    bool empty() const { return slots.empty(); }
+    void insert(ExecutionState *item, double weight);
+    void remove(ExecutionState *item);
+    void update(ExecutionState *item, double weight);
+    /// Choose an item for \p p in [0, 1).
+    ExecutionState *choose(double p) const;
+};
+
+/// WeightedRandomSearcher - non-uniform random search, weighting each state
+/// by the given heuristic.
+class WeightedRandomSearcher final : public Searcher {
+public:
+    enum WeightType {
+        Depth,       ///< prefer deep states
+        RandomPath   ///< 2^-depth, approximating a random walk down the fork tree
+    };
+
+private:
+    DiscretePDF states;
+    std::mt19937 &rng;
+    WeightType type;
+
+    double getWeight(ExecutionState *es);
+
+public:
+    WeightedRandomSearcher(WeightType type, std::mt19937 &rng)
+        : rng(rng), type(type) {}
+
+    ExecutionState &selectState() override;
+    void update(ExecutionState *current,
+                const std::vector<ExecutionState *> &addedStates,
+                const std::vector<ExecutionState *> &removedStates) override;
+    bool empty() override { return states.empty(); }
+    void printName(llvm::raw_ostream &os) override;
+};
+
+/// InterleavedSearcher - round-robin over several searchers, each of which
+/// sees every update.
+class InterleavedSearcher final : public Searcher {
+    std::vector<std::unique_ptr<Searcher>> searchers;
+    unsigned index = 0;
+
+public:
+    explicit InterleavedSearcher(std::vector<std::unique_ptr<Searcher>> searchers);
+
+    ExecutionState &selectState() override;
+    void update(ExecutionState *current,
+                const std::vector<ExecutionState *> &addedStates,
+                const std::vector<ExecutionState *> &removedStates) override;
+    bool empty() override { return searchers[0]->empty(); }
+    void printName(llvm::raw_ostream &os) override;
+};
+
+/// createSearcher - Create the searcher for \p types, interleaving them when
+/// more than one is given.
+std::unique_ptr<Searcher> createSearcher(const std::vector<SearcherType> &types,
+                                         std::mt19937 &rng);
+
+#endif // SEARCHER_H
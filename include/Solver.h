@@ -4,6 +4,7 @@
 #include "Expr.h"
 #include "Time.h"
 
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <vector>
@@ -80,7 +81,7 @@ namespace miniklee {
     /// Solver::Unknown
     ///
     /// \return True on success.
-    bool evaluate(const Query&);
+    bool evaluate(const Query&, Validity &result);
 
     /// mustBeTrue - Determine if the expression is provably true.
     /// 
@@ -213,15 +214,23 @@ namespace miniklee {
     std::unique_ptr<Solver>
     createAssignmentValidatingSolver(std::unique_ptr<Solver> s);
 
-    /// createCachingSolver - Create a solver which will cache the queries in
-    /// memory (without eviction).
-    std::unique_ptr<Solver> createCachingSolver(std::unique_ptr<Solver> s);
+    /// createCachingSolver - Create a solver which will cache the validity and
+    /// truth queries in memory, keyed by the query expression and the set of
+    /// constraints. Least recently used entries are evicted once the cache
+    /// holds more than \p maxCachedConstraints constraints in total.
+    std::unique_ptr<Solver>
+    createCachingSolver(std::unique_ptr<Solver> s,
+                        std::size_t maxCachedConstraints = 1 << 20);
 
     /// createCexCachingSolver - Create a counterexample caching solver. This is a
     /// more sophisticated cache which records counterexamples for a constraint
     /// set and uses subset/superset relations among constraints to try and
-    /// quickly find satisfying assignments.
-    std::unique_ptr<Solver> createCexCachingSolver(std::unique_ptr<Solver> s);
+    /// quickly find satisfying assignments. Least recently used results are
+    /// evicted once the sets they are stored for hold more than
+    /// \p maxCachedConstraints constraints in total.
+    std::unique_ptr<Solver>
+    createCexCachingSolver(std::unique_ptr<Solver> s,
+                           std::size_t maxCachedConstraints = 1 << 20);
 
     /// Creates a "fast counterexample solver" that quickly computes a satisfying 
     /// assignment for a constraint set using value propagation and range analysis.
@@ -50,7 +50,7 @@ namespace miniklee {
     /// Solver::Unknown
     ///
     /// \return True on success
-    virtual bool computeValidity(const Query& query);
+    virtual bool computeValidity(const Query& query, Solver::Validity &result);
     
     /// computeTruth - Determine whether the given query expression is provably true
     /// given the constraints.
@@ -77,11 +77,16 @@ namespace miniklee {
     virtual bool computeValue(const Query& query, ref<Expr> &result) = 0;
     
     /// \sa Solver::getInitialValues()
+    ///
+    /// \param [out] hasSolution - On success, true iff the query is
+    /// satisfiable; \p values is only filled in if it is.
+    /// \return True on success
     virtual bool computeInitialValues(const Query& query,
                                         const std::vector<const SymbolicExpr*> 
                                         &objects,
                                         std::vector< std::vector<int32_t> > 
-                                        &values) = 0;
+                                        &values,
+                                        bool &hasSolution) = 0;
     
     /// getOperationStatusCode - get the status of the last solver operation
     virtual SolverRunStatus getOperationStatusCode() = 0;
@@ -0,0 +1,47 @@
+#ifndef SYMBOLTABLE_H
+#define SYMBOLTABLE_H
+
+#include <cstdint>
+#include <string>
+
+namespace miniklee {
+
+/// A named symbolic input. Symbols are interned by SymbolTable and never
+/// freed, so two symbols are the same input iff they are the same object,
+/// and their ids are dense: per-symbol data can live in a flat vector
+/// indexed by id.
+struct Symbol {
+    /// Dense id, in order of first use, starting at 0.
+    const unsigned id;
+    const std::string name;
+    /// Width of one element, in bits.
+    const unsigned width;
+    /// Number of elements; 1 for a scalar.
+    const unsigned size;
+    /// Hash of the name, computed once.
+    const std::uint64_t hash;
+
+    Symbol(unsigned id, const std::string &name, unsigned width, unsigned size);
+};
+
+/// Global, thread-safe table of symbols.
+class SymbolTable {
+public:
+    /// The symbol called \p name, created with the given element width
+    /// and size on first use. Later calls must agree on them.
+    static const Symbol *get(const std::string &name, unsigned width = 32,
+                             unsigned size = 1);
+
+    /// The symbol called \p name, or null if there is none yet.
+    static const Symbol *find(const std::string &name);
+
+    /// The symbol with id \p id, which must have been handed out.
+    static const Symbol *lookup(unsigned id);
+
+    /// Number of symbols created so far; every id is below it.
+    static unsigned size();
+};
+
+} // namespace miniklee
+
+#endif // SYMBOLTABLE_H
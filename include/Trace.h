@@ -0,0 +1,79 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+
+/// Highest trace level compiled into the binary. Build with
+/// -DMINIKLEE_TRACE_LEVEL=0 to remove every trace point, arguments included.
+#ifndef MINIKLEE_TRACE_LEVEL
+#define MINIKLEE_TRACE_LEVEL 3
+#endif
+
+namespace miniklee {
+namespace trace {
+
+enum Level : unsigned {
+    None = 0,
+    Error = 1,
+    Info = 2,
+    Debug = 3
+};
+
+enum Category : unsigned {
+    Executor = 1u << 0,
+    Fork = 1u << 1,
+    Solver = 1u << 2
+};
+
+/// Runtime filter, set once by initialize() before any thread starts.
+extern unsigned activeLevel;
+extern unsigned activeCategories;
+
+inline bool isEnabled(Category c, Level l) {
+    return l <= activeLevel && (activeCategories & c);
+}
+
+/// Apply the command line options and install the exit and crash handlers
+/// that flush the ring buffer. Call after parsing the command line.
+void initialize();
+
+/// Write out and clear everything buffered so far.
+void flush();
+
+/// A trace event: a static message with up to three integer arguments,
+/// substituted for "{}" placeholders when the event is printed. Only the
+/// pointer to the message is stored, so it must be a string literal.
+struct Event {
+    static const unsigned MaxArgs = 3;
+
+    const char *message;
+    Category category;
+    Level level;
+    unsigned numArgs;
+    std::int64_t args[MaxArgs];
+};
+
+void record(const Event &e);
+
+template <typename... Args>
+inline void record(Category c, Level l, const char *message, Args... args) {
+    static_assert(sizeof...(Args) <= Event::MaxArgs, "too many trace arguments");
+    Event e{message, c, l, sizeof...(Args), {static_cast<std::int64_t>(args)...}};
+    record(e);
+}
+
+} // namespace trace
+} // namespace miniklee
+
+/// MINIKLEE_TRACE(category, level, "message {}", args...) - record a trace
+/// event when \p level is compiled in and enabled for \p category.
+#define MINIKLEE_TRACE(category, level, ...)                                   \
+    do {                                                                       \
+        if ((::miniklee::trace::level) <= MINIKLEE_TRACE_LEVEL &&              \
+            ::miniklee::trace::isEnabled(::miniklee::trace::category,          \
+                                         ::miniklee::trace::level))            \
+            ::miniklee::trace::record(::miniklee::trace::category,             \
+                                      ::miniklee::trace::level, __VA_ARGS__);  \
+    } while (0)
+
+#endif // TRACE_H
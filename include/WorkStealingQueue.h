@@ -0,0 +1,45 @@
+#ifndef WORKSTEALINGQUEUE_H
+#define WORKSTEALINGQUEUE_H
+
+#include <deque>
+#include <mutex>
+
+class ExecutionState;
+
+/// Per-worker deque of pending states for parallel exploration.
+///
+/// The owning worker pushes and pops at the back, so it explores its own
+/// subtree depth first. Idle workers steal from the front, taking the
+/// oldest, and therefore typically largest, pending subtree.
+class WorkStealingQueue {
+    std::mutex lock;
+    std::deque<ExecutionState *> states;
+
+public:
+    void push(ExecutionState *es) {
+        std::lock_guard<std::mutex> guard(lock);
+        states.push_back(es);
+    }
+
+    /// Take the most recently pushed state; called by the owner only.
+    ExecutionState *pop() {
+        std::lock_guard<std::mutex> guard(lock);
+        if (states.empty())
+            return nullptr;
+        ExecutionState *es = states.back();
+        states.pop_back();
+        return es;
+    }
+
+    /// Take the oldest state; called by other workers.
+    ExecutionState *steal() {
+        std::lock_guard<std::mutex> guard(lock);
+        if (states.empty())
+            return nullptr;
+        ExecutionState *es = states.front();
+        states.pop_front();
+        return es;
+    }
+};
+
+#endif // WORKSTEALINGQUEUE_H
@@ -5,6 +5,8 @@
 
 // #include "klee/Config/config.h"
 
+#include "ExprHashMap.h"
+
 #include <unordered_map>
 #include <z3.h>
 
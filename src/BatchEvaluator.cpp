@@ -0,0 +1,476 @@
+#include "BatchEvaluator.h"
+
+#include <algorithm>
+#include <climits>
+#include <unordered_map>
+#include <utility>
+
+#if !defined(MINIKLEE_BATCH_SCALAR) && defined(__AVX2__)
+#include <immintrin.h>
+#define MINIKLEE_BATCH_SIMD 1
+#elif !defined(MINIKLEE_BATCH_SCALAR) && defined(__SSE2__)
+#include <emmintrin.h>
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+#define MINIKLEE_BATCH_SIMD 1
+#endif
+
+using namespace miniklee;
+
+namespace {
+#ifdef MINIKLEE_BATCH_SIMD
+namespace simd {
+#ifdef __AVX2__
+typedef __m256i Vec;
+const std::size_t Lanes = 8;
+
+inline Vec load(const std::int32_t *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+inline void store(std::int32_t *p, Vec v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+}
+inline Vec splat(std::int32_t x) { return _mm256_set1_epi32(x); }
+inline Vec add(Vec a, Vec b) { return _mm256_add_epi32(a, b); }
+inline Vec sub(Vec a, Vec b) { return _mm256_sub_epi32(a, b); }
+inline Vec mul(Vec a, Vec b) { return _mm256_mullo_epi32(a, b); }
+inline Vec eq(Vec a, Vec b) { return _mm256_cmpeq_epi32(a, b); }
+inline Vec gt(Vec a, Vec b) { return _mm256_cmpgt_epi32(a, b); }
+inline Vec bitAnd(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+inline Vec bitXor(Vec a, Vec b) { return _mm256_xor_si256(a, b); }
+/// ~a & b
+inline Vec andNot(Vec a, Vec b) { return _mm256_andnot_si256(a, b); }
+#else
+typedef __m128i Vec;
+const std::size_t Lanes = 4;
+
+inline Vec load(const std::int32_t *p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+inline void store(std::int32_t *p, Vec v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+}
+inline Vec splat(std::int32_t x) { return _mm_set1_epi32(x); }
+inline Vec add(Vec a, Vec b) { return _mm_add_epi32(a, b); }
+inline Vec sub(Vec a, Vec b) { return _mm_sub_epi32(a, b); }
+inline Vec mul(Vec a, Vec b) {
+#ifdef __SSE4_1__
+    return _mm_mullo_epi32(a, b);
+#else
+    // Multiply even and odd lanes as 64-bit products, keep the low halves.
+    Vec even = _mm_mul_epu32(a, b);
+    Vec odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+#endif
+}
+inline Vec eq(Vec a, Vec b) { return _mm_cmpeq_epi32(a, b); }
+inline Vec gt(Vec a, Vec b) { return _mm_cmpgt_epi32(a, b); }
+inline Vec bitAnd(Vec a, Vec b) { return _mm_and_si128(a, b); }
+inline Vec bitXor(Vec a, Vec b) { return _mm_xor_si128(a, b); }
+/// ~a & b
+inline Vec andNot(Vec a, Vec b) { return _mm_andnot_si128(a, b); }
+#endif
+
+/// Unsigned comparison through the signed one by flipping the sign bits.
+inline Vec flipSign(Vec a) { return bitXor(a, splat(INT32_MIN)); }
+} // namespace simd
+#endif
+
+// Kernels: scalar() is the reference semantics, vector() the same over a
+// SIMD register. Comparisons and Bool results are 0 or 1 in every lane.
+
+struct NotKernel {
+    static std::int32_t scalar(std::int32_t a, std::int32_t) { return ~a; }
+#ifdef MINIKLEE_BATCH_SIMD
+    static simd::Vec vector(simd::Vec a, simd::Vec) {
+        return simd::bitXor(a, simd::splat(-1));
+    }
+#endif
+};
+
+struct NotBoolKernel {
+    static std::int32_t scalar(std::int32_t a, std::int32_t) { return a ^ 1; }
+#ifdef MINIKLEE_BATCH_SIMD
+    static simd::Vec vector(simd::Vec a, simd::Vec) {
+        return simd::bitXor(a, simd::splat(1));
+    }
+#endif
+};
+
+struct AddKernel {
+    static std::int32_t scalar(std::int32_t a, std::int32_t b) {
+        return static_cast<std::int32_t>(static_cast<std::uint32_t>(a) +
+                                         static_cast<std::uint32_t>(b));
+    }
+#ifdef MINIKLEE_BATCH_SIMD
+    static simd::Vec vector(simd::Vec a, simd::Vec b) { return simd::add(a, b); }
+#endif
+};
+
+struct SubKernel {
+    static std::int32_t scalar(std::int32_t a, std::int32_t b) {
+        return static_cast<std::int32_t>(static_cast<std::uint32_t>(a) -
+                                         static_cast<std::uint32_t>(b));
+    }
+#ifdef MINIKLEE_BATCH_SIMD
+    static simd::Vec vector(simd::Vec a, simd::Vec b) { return simd::sub(a, b); }
+#endif
+};
+
+struct MulKernel {
+    static std::int32_t scalar(std::int32_t a, std::int32_t b) {
+        return static_cast<std::int32_t>(static_cast<std::uint32_t>(a) *
+                                         static_cast<std::uint32_t>(b));
+    }
+#ifdef MINIKLEE_BATCH_SIMD
+    static simd::Vec vector(simd::Vec a, simd::Vec b) { return simd::mul(a, b); }
+#endif
+};
+
+/// No SIMD integer division on x86; these run the scalar loop only.
+struct UDivKernel {
+    static std::int32_t scalar(std::int32_t a, std::int32_t b) {
+        if (!b)
+            return 0;
+        return static_cast<std::int32_t>(static_cast<std::uint32_t>(a) /
+                                         static_cast<std::uint32_t>(b));
+    }
+};
+
+struct SDivKernel {
+    static std::int32_t scalar(std::int32_t a, std::int32_t b) {
+        if (!b)
+            return 0;
+        if (a == INT32_MIN && b == -1)
+            return INT32_MIN;
+        return a / b;
+    }
+};
+
+struct EqKernel {
+    static std::int32_t scalar(std::int32_t a, std::int32_t b) { return a == b; }
+#ifdef MINIKLEE_BATCH_SIMD
+    static simd::Vec vector(simd::Vec a, simd::Vec b) {
+        return simd::bitAnd(simd::eq(a, b), simd::splat(1));
+    }
+#endif
+};
+
+struct UltKernel {
+    static std::int32_t scalar(std::int32_t a, std::int32_t b) {
+        return static_cast<std::uint32_t>(a) < static_cast<std::uint32_t>(b);
+    }
+#ifdef MINIKLEE_BATCH_SIMD
+    static simd::Vec vector(simd::Vec a, simd::Vec b) {
+        return simd::bitAnd(simd::gt(simd::flipSign(b), simd::flipSign(a)),
+                            simd::splat(1));
+    }
+#endif
+};
+
+struct UleKernel {
+    static std::int32_t scalar(std::int32_t a, std::int32_t b) {
+        return static_cast<std::uint32_t>(a) <= static_cast<std::uint32_t>(b);
+    }
+#ifdef MINIKLEE_BATCH_SIMD
+    static simd::Vec vector(simd::Vec a, simd::Vec b) {
+        return simd::andNot(simd::gt(simd::flipSign(a), simd::flipSign(b)),
+                            simd::splat(1));
+    }
+#endif
+};
+
+struct SltKernel {
+    static std::int32_t scalar(std::int32_t a, std::int32_t b) { return a < b; }
+#ifdef MINIKLEE_BATCH_SIMD
+    static simd::Vec vector(simd::Vec a, simd::Vec b) {
+        return simd::bitAnd(simd::gt(b, a), simd::splat(1));
+    }
+#endif
+};
+
+struct SleKernel {
+    static std::int32_t scalar(std::int32_t a, std::int32_t b) { return a <= b; }
+#ifdef MINIKLEE_BATCH_SIMD
+    static simd::Vec vector(simd::Vec a, simd::Vec b) {
+        return simd::andNot(simd::gt(a, b), simd::splat(1));
+    }
+#endif
+};
+
+// \p d may alias \p a or \p b: every lane is read before it is written.
+
+template <typename Kernel>
+void applyScalar(std::int32_t *d, const std::int32_t *a, const std::int32_t *b,
+                 std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i)
+        d[i] = Kernel::scalar(a[i], b[i]);
+}
+
+template <typename Kernel>
+void apply(std::int32_t *d, const std::int32_t *a, const std::int32_t *b,
+           std::size_t n) {
+    std::size_t i = 0;
+#ifdef MINIKLEE_BATCH_SIMD
+    for (; i + simd::Lanes <= n; i += simd::Lanes)
+        simd::store(d + i, Kernel::vector(simd::load(a + i), simd::load(b + i)));
+#endif
+    applyScalar<Kernel>(d + i, a + i, b + i, n - i);
+}
+
+unsigned getNumOperands(BatchEvaluator::Op op) {
+    switch (op) {
+    case BatchEvaluator::Op::Const:
+    case BatchEvaluator::Op::Input:
+        return 0;
+    case BatchEvaluator::Op::Not:
+    case BatchEvaluator::Op::NotBool:
+        return 1;
+    default:
+        return 2;
+    }
+}
+} // namespace
+
+const std::size_t BatchEvaluator::BlockLanes;
+
+BatchEvaluator::BatchEvaluator(const ref<Expr> &root) {
+    compile(std::vector<ref<Expr>>(1, root));
+    allocateRegisters();
+}
+
+BatchEvaluator::BatchEvaluator(const std::vector<ref<Expr>> &roots) {
+    compile(roots);
+    allocateRegisters();
+}
+
+/// Emit one instruction per distinct node in post order. Until register
+/// allocation, an instruction's operands and result are named by the index
+/// of the instruction producing them.
+void BatchEvaluator::compile(const std::vector<ref<Expr>> &exprs) {
+    std::unordered_map<const Expr *, std::uint32_t> values;
+    // Explicit stack: path conditions can be deeper than the call stack.
+    std::vector<std::pair<const Expr *, bool>> stack;
+
+    auto emit = [&](Op op, std::uint32_t a, std::uint32_t b, std::int32_t imm) {
+        std::uint32_t index = program.size();
+        program.push_back(Instruction{op, index, a, b, imm});
+        return index;
+    };
+
+    for (const ref<Expr> &root : exprs) {
+        stack.emplace_back(root.get(), false);
+        while (!stack.empty()) {
+            const Expr *e = stack.back().first;
+            if (values.count(e)) {
+                stack.pop_back();
+                continue;
+            }
+            if (!stack.back().second) {
+                stack.back().second = true;
+                for (unsigned i = 0; i < e->getNumKids(); ++i)
+                    stack.emplace_back(e->getKid(i).get(), false);
+                continue;
+            }
+            stack.pop_back();
+
+            std::uint32_t a = 0, b = 0;
+            if (e->getNumKids() > 0)
+                a = values[e->getKid(0).get()];
+            if (e->getNumKids() > 1)
+                b = values[e->getKid(1).get()];
+
+            std::uint32_t result;
+            switch (e->getKind()) {
+            case Expr::Constant: {
+                const ConstantExpr *c = cast<ConstantExpr>(e);
+                assert(c->getWidth() <= 32 && "Unsupported constant width");
+                result = emit(Op::Const, 0, 0, static_cast<std::int32_t>(c->getZExtValue()));
+                break;
+            }
+            case Expr::Symbolic: {
+                const Symbol *symbol = cast<SymbolicExpr>(e)->getSymbol();
+                if (symbol->id >= columns.size())
+                    columns.resize(symbol->id + 1, -1);
+                if (columns[symbol->id] < 0) {
+                    columns[symbol->id] = symbols.size();
+                    symbols.push_back(symbol);
+                }
+                result = emit(Op::Input, 0, 0, columns[symbol->id]);
+                break;
+            }
+            case Expr::Not:
+                result = emit(e->getWidth() == Expr::Bool ? Op::NotBool : Op::Not, a, a, 0);
+                break;
+            case Expr::Add:  result = emit(Op::Add, a, b, 0); break;
+            case Expr::Sub:  result = emit(Op::Sub, a, b, 0); break;
+            case Expr::Mul:  result = emit(Op::Mul, a, b, 0); break;
+            case Expr::UDiv: result = emit(Op::UDiv, a, b, 0); break;
+            case Expr::SDiv: result = emit(Op::SDiv, a, b, 0); break;
+            case Expr::Eq:   result = emit(Op::Eq, a, b, 0); break;
+            case Expr::Ult:  result = emit(Op::Ult, a, b, 0); break;
+            case Expr::Ule:  result = emit(Op::Ule, a, b, 0); break;
+            case Expr::Slt:  result = emit(Op::Slt, a, b, 0); break;
+            case Expr::Sle:  result = emit(Op::Sle, a, b, 0); break;
+            // Non-canonical comparisons, in case they were built with alloc.
+            case Expr::Ne: {
+                std::uint32_t eq = emit(Op::Eq, a, b, 0);
+                result = emit(Op::NotBool, eq, eq, 0);
+                break;
+            }
+            case Expr::Ugt:  result = emit(Op::Ult, b, a, 0); break;
+            case Expr::Uge:  result = emit(Op::Ule, b, a, 0); break;
+            case Expr::Sgt:  result = emit(Op::Slt, b, a, 0); break;
+            case Expr::Sge:  result = emit(Op::Sle, b, a, 0); break;
+            default:
+                assert(0 && "Unsupported expression kind");
+                result = emit(Op::Const, 0, 0, 0);
+            }
+            values[e] = result;
+        }
+        roots.push_back(values[root.get()]);
+    }
+}
+
+/// Linear scan over the program: an operand's register is freed at its
+/// last use and may be reused as that instruction's result. Roots and
+/// constants, which are only written once per call, stay live to the end.
+void BatchEvaluator::allocateRegisters() {
+    const std::uint32_t Forever = program.size();
+    std::vector<std::uint32_t> lastUse(program.size());
+    for (std::uint32_t i = 0; i < program.size(); ++i) {
+        lastUse[i] = program[i].op == Op::Const ? Forever : i;
+        unsigned n = getNumOperands(program[i].op);
+        if (n > 0 && lastUse[program[i].a] != Forever)
+            lastUse[program[i].a] = i;
+        if (n > 1 && lastUse[program[i].b] != Forever)
+            lastUse[program[i].b] = i;
+    }
+    for (std::uint32_t root : roots)
+        lastUse[root] = Forever;
+
+    std::vector<std::uint32_t> assigned(program.size());
+    std::vector<std::uint32_t> freeRegisters;
+    for (std::uint32_t i = 0; i < program.size(); ++i) {
+        Instruction &inst = program[i];
+        unsigned n = getNumOperands(inst.op);
+        std::uint32_t a = inst.a, b = inst.b;
+        if (n > 0) {
+            inst.a = assigned[a];
+            if (lastUse[a] == i)
+                freeRegisters.push_back(inst.a);
+        }
+        if (n > 1) {
+            inst.b = assigned[b];
+            if (lastUse[b] == i && b != a)
+                freeRegisters.push_back(inst.b);
+        }
+        if (n == 1)
+            inst.b = inst.a;
+
+        // Constants are written before the program runs, so their
+        // registers must not have held anything else.
+        if (freeRegisters.empty() || inst.op == Op::Const) {
+            inst.dest = numRegisters++;
+        } else {
+            inst.dest = freeRegisters.back();
+            freeRegisters.pop_back();
+        }
+        assigned[i] = inst.dest;
+    }
+
+    for (std::uint32_t &root : roots)
+        root = assigned[root];
+}
+
+/// Scratch space for one evaluate() or filter() call.
+struct BatchEvaluator::Frame {
+    /// BlockLanes values per register.
+    std::vector<std::int32_t> regs;
+    /// Where each register's current block lives: its slot in regs, or
+    /// the input column itself for Input.
+    std::vector<const std::int32_t *> values;
+
+    explicit Frame(const BatchEvaluator &be)
+        : regs(be.numRegisters * BlockLanes), values(be.numRegisters) {
+        for (const Instruction &inst : be.program) {
+            if (inst.op != Op::Const)
+                continue;
+            std::int32_t *d = regs.data() + inst.dest * BlockLanes;
+            std::fill(d, d + BlockLanes, inst.imm);
+            values[inst.dest] = d;
+        }
+    }
+};
+
+void BatchEvaluator::run(const std::int32_t *const *inputs, std::size_t base,
+                         std::size_t lanes, Frame &frame) const {
+    for (const Instruction &inst : program) {
+        if (inst.op == Op::Const)
+            continue;
+        if (inst.op == Op::Input) {
+            frame.values[inst.dest] = inputs[inst.imm] + base;
+            continue;
+        }
+
+        std::int32_t *d = frame.regs.data() + inst.dest * BlockLanes;
+        const std::int32_t *a = frame.values[inst.a];
+        const std::int32_t *b = frame.values[inst.b];
+
+        switch (inst.op) {
+        case Op::Not:     apply<NotKernel>(d, a, b, lanes); break;
+        case Op::NotBool: apply<NotBoolKernel>(d, a, b, lanes); break;
+        case Op::Add:     apply<AddKernel>(d, a, b, lanes); break;
+        case Op::Sub:     apply<SubKernel>(d, a, b, lanes); break;
+        case Op::Mul:     apply<MulKernel>(d, a, b, lanes); break;
+        case Op::UDiv:    applyScalar<UDivKernel>(d, a, b, lanes); break;
+        case Op::SDiv:    applyScalar<SDivKernel>(d, a, b, lanes); break;
+        case Op::Eq:      apply<EqKernel>(d, a, b, lanes); break;
+        case Op::Ult:     apply<UltKernel>(d, a, b, lanes); break;
+        case Op::Ule:     apply<UleKernel>(d, a, b, lanes); break;
+        case Op::Slt:     apply<SltKernel>(d, a, b, lanes); break;
+        case Op::Sle:     apply<SleKernel>(d, a, b, lanes); break;
+        default:
+            assert(0 && "unexpected op");
+        }
+        frame.values[inst.dest] = d;
+    }
+}
+
+void BatchEvaluator::evaluate(const std::int32_t *const *inputs, std::size_t count,
+                              std::int32_t *const *outputs) const {
+    Frame frame(*this);
+    for (std::size_t base = 0; base < count; base += BlockLanes) {
+        std::size_t lanes = std::min(BlockLanes, count - base);
+        run(inputs, base, lanes, frame);
+        for (std::size_t i = 0; i < roots.size(); ++i) {
+            const std::int32_t *r = frame.values[roots[i]];
+            std::copy(r, r + lanes, outputs[i] + base);
+        }
+    }
+}
+
+std::size_t BatchEvaluator::filter(const std::int32_t *const *inputs, std::size_t count,
+                                   std::uint8_t *satisfied) const {
+    Frame frame(*this);
+    std::int32_t all[BlockLanes];
+    std::size_t total = 0;
+    for (std::size_t base = 0; base < count; base += BlockLanes) {
+        std::size_t lanes = std::min(BlockLanes, count - base);
+        run(inputs, base, lanes, frame);
+
+        std::fill(all, all + lanes, 1);
+        for (std::uint32_t root : roots) {
+            const std::int32_t *r = frame.values[root];
+            for (std::size_t j = 0; j < lanes; ++j)
+                all[j] &= r[j];
+        }
+        for (std::size_t j = 0; j < lanes; ++j) {
+            satisfied[base + j] = all[j];
+            total += all[j];
+        }
+    }
+    return total;
+}
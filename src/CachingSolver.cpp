@@ -0,0 +1,188 @@
+#include "Solver.h"
+
+#include "Constraints.h"
+#include "SolverImpl.h"
+#include "Trace.h"
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace miniklee {
+
+/// Remembers the answers of the underlying solver, keyed by the query
+/// expression and the constraints in any order, so sibling states that
+/// reach the same branch with the same path condition share one call.
+///
+/// The key hash combines ConstraintSet::hash(), which does not depend on
+/// the order of the constraints and costs O(1), with the expression's
+/// hash. Constraints are only compared on a hash hit. Only successful
+/// answers are stored.
+///
+/// Entries are evicted least recently used first once they hold more than
+/// maxCost constraints in total, which bounds the memory the cache keeps
+/// alive however long the run.
+class CachingSolver : public SolverImpl {
+public:
+    CachingSolver(std::unique_ptr<Solver> solver, std::size_t maxCost)
+        : solver(std::move(solver)), maxCost(maxCost) {}
+    ~CachingSolver();
+
+    bool computeValidity(const Query &, Solver::Validity &result);
+    bool computeTruth(const Query &, bool &isValid);
+    bool computeValue(const Query &query, ref<Expr> &result) {
+        return solver->impl->computeValue(query, result);
+    }
+    bool computeInitialValues(const Query &query,
+                              const std::vector<const SymbolicExpr *> &objects,
+                              std::vector<std::vector<int32_t> > &values,
+                              bool &hasSolution) {
+        return solver->impl->computeInitialValues(query, objects, values,
+                                                  hasSolution);
+    }
+    SolverRunStatus getOperationStatusCode() {
+        return solver->impl->getOperationStatusCode();
+    }
+    std::string getConstraintLog(const Query &query) {
+        return solver->impl->getConstraintLog(query);
+    }
+    void setCoreSolverTimeout(time::Span timeout) {
+        solver->impl->setCoreSolverTimeout(timeout);
+    }
+
+private:
+    struct Entry {
+        /// Shares its nodes with the querying state's path condition.
+        ConstraintSet constraints;
+        ref<Expr> expr;
+        std::uint64_t hash;
+
+        bool hasValidity = false;
+        Solver::Validity validity = Solver::Unknown;
+        bool hasTruth = false;
+        bool isValid = false;
+
+        std::size_t cost() const { return constraints.size() + 1; }
+    };
+
+    typedef std::list<Entry> EntryList;
+
+    std::unique_ptr<Solver> solver;
+    std::size_t maxCost;
+    std::size_t cost = 0;
+
+    /// Most recently used first.
+    EntryList entries;
+    std::unordered_multimap<std::uint64_t, EntryList::iterator> index;
+
+    std::uint64_t hits = 0, misses = 0, evictions = 0;
+
+    static std::uint64_t hashQuery(const Query &query);
+
+    /// The entry for \p query, whose hash is \p h, moved to the front, or
+    /// null.
+    Entry *lookup(const Query &query, std::uint64_t h);
+    /// A new entry for \p query, evicting others to stay within budget.
+    Entry &insert(const Query &query, std::uint64_t h);
+    void evict();
+};
+
+CachingSolver::~CachingSolver() {
+    MINIKLEE_TRACE(Solver, Info, "Query cache: {} hits, {} misses, {} evictions",
+                   hits, misses, evictions);
+}
+
+std::uint64_t CachingSolver::hashQuery(const Query &query) {
+    return hashCombine(hashCombine(query.constraints.size(), query.constraints.hash()),
+                       query.expr->hash());
+}
+
+CachingSolver::Entry *CachingSolver::lookup(const Query &query, std::uint64_t h) {
+    auto range = index.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it) {
+        Entry &e = *it->second;
+        // Expressions are hash-consed, so comparing pointers is exact.
+        if (e.expr.get() == query.expr.get() &&
+            e.constraints.sameConstraints(query.constraints)) {
+            entries.splice(entries.begin(), entries, it->second);
+            return &e;
+        }
+    }
+    return nullptr;
+}
+
+CachingSolver::Entry &CachingSolver::insert(const Query &query, std::uint64_t h) {
+    entries.emplace_front();
+    Entry &e = entries.front();
+    e.constraints = query.constraints;
+    e.expr = query.expr;
+    e.hash = h;
+    index.emplace(h, entries.begin());
+    cost += e.cost();
+    evict();
+    return e;
+}
+
+/// Drop least recently used entries until the cache is within budget,
+/// always keeping the newest one.
+void CachingSolver::evict() {
+    while (cost > maxCost && entries.size() > 1) {
+        Entry &e = entries.back();
+        auto range = index.equal_range(e.hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (&*it->second == &e) {
+                index.erase(it);
+                break;
+            }
+        }
+        cost -= e.cost();
+        entries.pop_back();
+        ++evictions;
+    }
+}
+
+bool CachingSolver::computeValidity(const Query &query, Solver::Validity &result) {
+    std::uint64_t h = hashQuery(query);
+    Entry *e = lookup(query, h);
+    if (e && e->hasValidity) {
+        ++hits;
+        result = e->validity;
+        return true;
+    }
+    ++misses;
+    if (!solver->impl->computeValidity(query, result))
+        return false; // failures are not cached
+    if (!e)
+        e = &insert(query, h);
+    e->validity = result;
+    e->hasValidity = true;
+    return true;
+}
+
+bool CachingSolver::computeTruth(const Query &query, bool &isValid) {
+    std::uint64_t h = hashQuery(query);
+    Entry *e = lookup(query, h);
+    if (e && e->hasTruth) {
+        ++hits;
+        isValid = e->isValid;
+        return true;
+    }
+    ++misses;
+    if (!solver->impl->computeTruth(query, isValid))
+        return false; // failures are not cached
+    if (!e)
+        e = &insert(query, h);
+    e->isValid = isValid;
+    e->hasTruth = true;
+    return true;
+}
+
+std::unique_ptr<Solver> createCachingSolver(std::unique_ptr<Solver> s,
+                                            std::size_t maxCachedConstraints) {
+    return std::make_unique<Solver>(
+        std::make_unique<CachingSolver>(std::move(s), maxCachedConstraints));
+}
+
+} // namespace miniklee
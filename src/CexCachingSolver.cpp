@@ -0,0 +1,528 @@
+#include "Solver.h"
+
+#include "BatchEvaluator.h"
+#include "Constraints.h"
+#include "ExprHashMap.h"
+#include "SolverImpl.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace miniklee {
+
+/// Answers satisfiability queries from the results of earlier ones.
+///
+/// Every query is a set of Bool expressions, the constraints plus the
+/// query expression, whose conjunction is satisfiable or not. Results are
+/// kept in a set-trie (UBTree) over these sets, along with the satisfying
+/// assignment when one is known. Path conditions only grow along a path,
+/// so a query can often be settled by a related one:
+///
+///  - a stored unsatisfiable subset makes it unsatisfiable;
+///  - a stored satisfiable superset makes it satisfiable;
+///  - an assignment stored for a subset often still satisfies it, which
+///    is checked for all such assignments at once with BatchEvaluator.
+///
+/// Only what the underlying solver could not be spared reaches it, as one
+/// computeInitialValues call that both decides a query and gives a model.
+/// computeValidity evaluates the query expression in a model of the
+/// constraints, which settles one side of it, and solves only the other.
+///
+/// Results are evicted least recently used first once the sets they are
+/// stored for hold more than maxCost expressions in total. The trie nodes
+/// left holding nothing are dropped with them, and so are the ids of the
+/// expressions no remaining node is labelled with.
+class CexCachingSolver : public SolverImpl {
+public:
+    CexCachingSolver(std::unique_ptr<Solver> solver, std::size_t maxCost)
+        : solver(std::move(solver)), maxCost(maxCost) {}
+    ~CexCachingSolver();
+
+    bool computeValidity(const Query &, Solver::Validity &result);
+    bool computeTruth(const Query &, bool &isValid);
+    bool computeValue(const Query &query, ref<Expr> &result) {
+        return solver->impl->computeValue(query, result);
+    }
+    bool computeInitialValues(const Query &query,
+                              const std::vector<const SymbolicExpr *> &objects,
+                              std::vector<std::vector<int32_t> > &values,
+                              bool &hasSolution) {
+        return solver->impl->computeInitialValues(query, objects, values,
+                                                  hasSolution);
+    }
+    SolverRunStatus getOperationStatusCode() {
+        return solver->impl->getOperationStatusCode();
+    }
+    std::string getConstraintLog(const Query &query) {
+        return solver->impl->getConstraintLog(query);
+    }
+    void setCoreSolverTimeout(time::Span timeout) {
+        solver->impl->setCoreSolverTimeout(timeout);
+    }
+
+private:
+    /// Most stored assignments tried against one query.
+    static const std::size_t MaxCandidates = BatchEvaluator::BlockLanes;
+
+    /// Values of the symbols of a satisfiable set, sorted by symbol id.
+    struct Assignment {
+        typedef std::pair<const Symbol *, std::int32_t> Binding;
+        std::vector<Binding> bindings;
+
+        static bool less(const Binding &a, const Binding &b) {
+            return a.first->id < b.first->id;
+        }
+
+        /// The value of \p symbol, or 0 if it is not bound.
+        std::int32_t get(const Symbol *symbol) const;
+    };
+
+    struct Node;
+    typedef std::list<Node *> NodeList;
+
+    struct Result {
+        bool satisfiable;
+        /// Null if unsatisfiable, or if the model is not known.
+        std::shared_ptr<const Assignment> model;
+        /// The node holding this result, in the recency list.
+        NodeList::iterator position;
+    };
+
+    /// A set-trie node: the path from the root spells a sorted set.
+    struct Node {
+        Node *parent = nullptr;
+        /// The id the edge from the parent is labelled with.
+        unsigned id = 0;
+        /// The size of the set spelled, which is what a result here costs.
+        std::size_t depth = 0;
+        std::map<unsigned, std::unique_ptr<Node>> children;
+        std::unique_ptr<Result> result;
+    };
+
+    /// An expression with an id, and the number of trie edges labelled
+    /// with it.
+    struct Use {
+        ref<Expr> expr;
+        std::size_t edges;
+    };
+
+    /// A query as the sorted ids of its expressions.
+    typedef std::vector<unsigned> Key;
+
+    std::unique_ptr<Solver> solver;
+    std::size_t maxCost;
+    std::size_t cost = 0;
+    Node root;
+    /// Nodes holding a result, most recently used first.
+    NodeList recent;
+
+    /// Every distinct expression in the trie or in a query being answered,
+    /// numbered in order of first appearance. Sorted by these numbers, the
+    /// queries along one path are prefixes of each other and share trie
+    /// nodes, and a lookup only visits a handful of nodes per constraint.
+    ExprHashMap<unsigned> ids;
+    /// By id, for releasing them.
+    std::unordered_map<unsigned, Use> uses;
+    unsigned nextId = 0;
+
+    std::uint64_t queries = 0, answered = 0, evictions = 0;
+
+    Key makeKey(const std::vector<ref<Expr>> &exprs);
+    /// Drop \p id if it labels no trie edge.
+    void release(unsigned id);
+
+    const Result *findExact(const Key &key) const;
+    /// A stored unsatisfiable subset of \p key, if any. Collects up to
+    /// MaxCandidates models of satisfiable subsets along the way.
+    const Result *findUnsatSubset(const Key &key,
+                                  std::vector<const Assignment *> &models) const;
+    /// A stored satisfiable superset of \p key, if any.
+    const Result *findSatSuperset(const Key &key) const;
+    /// The first of \p models satisfying every root of \p evaluator,
+    /// completed with zeros for the symbols it does not bind.
+    static std::shared_ptr<const Assignment>
+    findModel(const BatchEvaluator &evaluator,
+              const std::vector<const Assignment *> &models);
+
+    /// Store a result for \p key, as the most recently used one, evicting
+    /// others to stay within budget.
+    void insert(const Key &key, bool satisfiable,
+                std::shared_ptr<const Assignment> model = nullptr);
+    void touch(const Result &r) {
+        recent.splice(recent.begin(), recent, r.position);
+    }
+    void evict();
+    /// Answer the conjunction of \p exprs, whose key is \p key, from the
+    /// cache; returns false on a miss. \p evaluator is compiled from
+    /// \p exprs if the stored models need checking and it is not yet.
+    bool lookup(const Key &key, const std::vector<ref<Expr>> &exprs,
+                std::unique_ptr<BatchEvaluator> &evaluator, bool &satisfiable);
+    /// Ask the underlying solver for a model of \p query, whose conjunction
+    /// with its constraints is compiled in \p evaluator. Returns false if
+    /// the solver failed; \p model is only set if the one found checks out.
+    bool solve(const Query &query, const BatchEvaluator &evaluator,
+               bool &satisfiable, std::shared_ptr<const Assignment> &model);
+    /// Whether the constraints of \p query and \p expr are satisfiable,
+    /// from the cache or else from one call to the underlying solver.
+    /// Sets \p model to a model if one is known. Returns false if the
+    /// solver failed, which is not cached.
+    bool isSatisfiable(const Query &query, const ref<Expr> &expr, bool &satisfiable,
+                       std::shared_ptr<const Assignment> *model = nullptr);
+};
+
+std::int32_t CexCachingSolver::Assignment::get(const Symbol *symbol) const {
+    auto it = std::lower_bound(bindings.begin(), bindings.end(),
+                               Binding(symbol, 0), less);
+    return it != bindings.end() && it->first == symbol ? it->second : 0;
+}
+
+CexCachingSolver::~CexCachingSolver() {
+    MINIKLEE_TRACE(Solver, Info,
+                   "Counterexample cache: {} of {} queries ({}%) answered without the solver",
+                   answered, queries, queries ? answered * 100 / queries : 0);
+    MINIKLEE_TRACE(Solver, Info, "Counterexample cache: {} evictions", evictions);
+}
+
+CexCachingSolver::Key CexCachingSolver::makeKey(const std::vector<ref<Expr>> &exprs) {
+    Key key;
+    key.reserve(exprs.size());
+    for (const ref<Expr> &e : exprs) {
+        auto inserted = ids.insert(std::make_pair(e, nextId));
+        if (inserted.second)
+            uses.emplace(nextId++, Use{e, 0});
+        key.push_back(inserted.first->second);
+    }
+    std::sort(key.begin(), key.end());
+    key.erase(std::unique(key.begin(), key.end()), key.end());
+    return key;
+}
+
+void CexCachingSolver::release(unsigned id) {
+    auto it = uses.find(id);
+    if (it != uses.end() && it->second.edges == 0) {
+        ids.erase(it->second.expr);
+        uses.erase(it);
+    }
+}
+
+const CexCachingSolver::Result *CexCachingSolver::findExact(const Key &key) const {
+    const Node *node = &root;
+    for (unsigned id : key) {
+        auto it = node->children.find(id);
+        if (it == node->children.end())
+            return nullptr;
+        node = it->second.get();
+    }
+    return node->result.get();
+}
+
+// Both searches below walk the trie with an explicit stack of (node,
+// position in key): path conditions can be deeper than the call stack.
+// Every trie node spells a distinct set, so each is visited at most once.
+
+const CexCachingSolver::Result *
+CexCachingSolver::findUnsatSubset(const Key &key,
+                                  std::vector<const Assignment *> &models) const {
+    std::vector<std::pair<const Node *, std::size_t>> stack;
+    stack.emplace_back(&root, 0);
+    while (!stack.empty()) {
+        const Node *node = stack.back().first;
+        std::size_t pos = stack.back().second;
+        stack.pop_back();
+
+        if (const Result *r = node->result.get()) {
+            if (!r->satisfiable)
+                return r;
+            if (r->model && models.size() < MaxCandidates)
+                models.push_back(r->model.get());
+        }
+        // Look up whichever is smaller, the children or the rest of the
+        // key, in the other; both are sorted.
+        if (node->children.size() < key.size() - pos) {
+            auto k = key.begin() + pos;
+            for (const auto &child : node->children) {
+                k = std::lower_bound(k, key.end(), child.first);
+                if (k == key.end())
+                    break;
+                if (*k == child.first)
+                    stack.emplace_back(child.second.get(), k - key.begin() + 1);
+            }
+        } else {
+            for (std::size_t i = pos; i < key.size(); ++i) {
+                auto it = node->children.find(key[i]);
+                if (it != node->children.end())
+                    stack.emplace_back(it->second.get(), i + 1);
+            }
+        }
+    }
+    return nullptr;
+}
+
+const CexCachingSolver::Result *
+CexCachingSolver::findSatSuperset(const Key &key) const {
+    std::vector<std::pair<const Node *, std::size_t>> stack;
+    stack.emplace_back(&root, 0);
+    while (!stack.empty()) {
+        const Node *node = stack.back().first;
+        std::size_t pos = stack.back().second;
+        stack.pop_back();
+
+        if (pos == key.size() && node->result && node->result->satisfiable)
+            return node->result.get();
+        for (const auto &child : node->children) {
+            if (pos == key.size() || child.first < key[pos]) {
+                // An extra element; the superset may still contain the rest.
+                stack.emplace_back(child.second.get(), pos);
+            } else {
+                if (child.first == key[pos])
+                    stack.emplace_back(child.second.get(), pos + 1);
+                // Children are sorted, so none of the rest holds key[pos].
+                break;
+            }
+        }
+    }
+    return nullptr;
+}
+
+std::shared_ptr<const CexCachingSolver::Assignment>
+CexCachingSolver::findModel(const BatchEvaluator &evaluator,
+                            const std::vector<const Assignment *> &models) {
+    if (models.empty())
+        return nullptr;
+
+    const std::vector<const Symbol *> &symbols = evaluator.getSymbols();
+    std::vector<std::vector<std::int32_t>> columns(symbols.size());
+    std::vector<const std::int32_t *> inputs(symbols.size());
+    for (std::size_t s = 0; s < symbols.size(); ++s) {
+        for (const Assignment *m : models)
+            columns[s].push_back(m->get(symbols[s]));
+        inputs[s] = columns[s].data();
+    }
+
+    std::vector<std::uint8_t> satisfied(models.size());
+    if (evaluator.filter(inputs.data(), models.size(), satisfied.data()) == 0)
+        return nullptr;
+
+    std::size_t lane = std::find(satisfied.begin(), satisfied.end(), 1) - satisfied.begin();
+    std::shared_ptr<Assignment> model = std::make_shared<Assignment>();
+    for (std::size_t s = 0; s < symbols.size(); ++s)
+        model->bindings.emplace_back(symbols[s], columns[s][lane]);
+    std::sort(model->bindings.begin(), model->bindings.end(), Assignment::less);
+    return model;
+}
+
+void CexCachingSolver::insert(const Key &key, bool satisfiable,
+                              std::shared_ptr<const Assignment> model) {
+    Node *node = &root;
+    for (unsigned id : key) {
+        std::unique_ptr<Node> &child = node->children[id];
+        if (!child) {
+            child.reset(new Node());
+            child->parent = node;
+            child->id = id;
+            child->depth = node->depth + 1;
+            ++uses.find(id)->second.edges;
+        }
+        node = child.get();
+    }
+    if (node->result) {
+        if (satisfiable && model && !node->result->model)
+            node->result->model = std::move(model);
+        touch(*node->result);
+    } else {
+        recent.push_front(node);
+        node->result.reset(new Result{satisfiable, std::move(model), recent.begin()});
+        cost += node->depth;
+    }
+    evict();
+}
+
+/// Drop least recently used results until the cache is within budget,
+/// always keeping the newest one, along with the nodes and ids only they
+/// needed.
+void CexCachingSolver::evict() {
+    while (cost > maxCost && recent.size() > 1) {
+        Node *node = recent.back();
+        recent.pop_back();
+        cost -= node->depth;
+        node->result.reset();
+        ++evictions;
+
+        while (node != &root && !node->result && node->children.empty()) {
+            Node *parent = node->parent;
+            unsigned id = node->id;
+            --uses.find(id)->second.edges;
+            parent->children.erase(id); // destroys node
+            release(id);
+            node = parent;
+        }
+    }
+}
+
+bool CexCachingSolver::lookup(const Key &key, const std::vector<ref<Expr>> &exprs,
+                              std::unique_ptr<BatchEvaluator> &evaluator,
+                              bool &satisfiable) {
+    ++queries;
+    if (const Result *r = findExact(key)) {
+        touch(*r);
+        satisfiable = r->satisfiable;
+        ++answered;
+        return true;
+    }
+
+    std::vector<const Assignment *> models;
+    if (const Result *r = findUnsatSubset(key, models)) {
+        touch(*r);
+        insert(key, false);
+        satisfiable = false;
+        ++answered;
+        return true;
+    }
+    if (const Result *r = findSatSuperset(key)) {
+        touch(*r);
+        insert(key, true, r->model);
+        satisfiable = true;
+        ++answered;
+        return true;
+    }
+    if (models.empty())
+        return false;
+    if (!evaluator)
+        evaluator = std::make_unique<BatchEvaluator>(exprs);
+    if (std::shared_ptr<const Assignment> model = findModel(*evaluator, models)) {
+        insert(key, true, std::move(model));
+        satisfiable = true;
+        ++answered;
+        return true;
+    }
+    return false;
+}
+
+bool CexCachingSolver::solve(const Query &query, const BatchEvaluator &evaluator,
+                             bool &satisfiable,
+                             std::shared_ptr<const Assignment> &model) {
+    const std::vector<const Symbol *> &symbols = evaluator.getSymbols();
+    std::vector<ref<Expr>> objectExprs;
+    std::vector<const SymbolicExpr *> objects;
+    for (const Symbol *s : symbols) {
+        objectExprs.push_back(SymbolicExpr::create(s));
+        objects.push_back(cast<SymbolicExpr>(objectExprs.back().get()));
+    }
+    // Initial values are only computed if there are some, so this one
+    // call decides satisfiability and gives a model.
+    std::vector<std::vector<int32_t>> values(objects.size());
+    if (!solver->impl->computeInitialValues(query, objects, values, satisfiable))
+        return false;
+    if (!satisfiable)
+        return true;
+
+    std::shared_ptr<Assignment> m = std::make_shared<Assignment>();
+    for (std::size_t s = 0; s < symbols.size(); ++s) {
+        if (values[s].empty())
+            return true;
+        m->bindings.emplace_back(symbols[s], values[s].front());
+    }
+    std::sort(m->bindings.begin(), m->bindings.end(), Assignment::less);
+
+    // Keep the model only if it really satisfies the query.
+    std::vector<const Assignment *> models(1, m.get());
+    if (findModel(evaluator, models))
+        model = std::move(m);
+    return true;
+}
+
+bool CexCachingSolver::isSatisfiable(const Query &query, const ref<Expr> &expr,
+                                     bool &satisfiable,
+                                     std::shared_ptr<const Assignment> *model) {
+    std::vector<ref<Expr>> exprs = query.constraints.toVector();
+    exprs.push_back(expr);
+    Key key = makeKey(exprs);
+    // Compiled only once a stored model or a new one needs checking: most
+    // queries along a path are settled before that.
+    std::unique_ptr<BatchEvaluator> evaluator;
+    if (!lookup(key, exprs, evaluator, satisfiable)) {
+        if (!evaluator)
+            evaluator = std::make_unique<BatchEvaluator>(exprs);
+        std::shared_ptr<const Assignment> m;
+        if (!solve(Query(query.constraints, expr), *evaluator, satisfiable, m)) {
+            // Nothing is stored, so the ids this query added are unused.
+            for (unsigned id : key)
+                release(id);
+            return false;
+        }
+        insert(key, satisfiable, std::move(m));
+    }
+    if (model && satisfiable)
+        *model = findExact(key)->model;
+    return true;
+}
+
+bool CexCachingSolver::computeValidity(const Query &query, Solver::Validity &result) {
+    // A model of the constraints alone takes the expression one way, so
+    // that side is satisfiable and only the other needs solving. Along a
+    // path the model is usually cached already, by the query that added
+    // the newest constraint. Any assignment satisfies no constraints.
+    std::shared_ptr<const Assignment> model = std::make_shared<Assignment>();
+    if (!query.constraints.empty()) {
+        ConstraintSet rest = query.constraints.withoutBack();
+        ref<Expr> newest = query.constraints.back();
+        model = nullptr;
+        bool satisfiable;
+        if (!isSatisfiable(Query(rest, newest), newest, satisfiable, &model) ||
+            !satisfiable)
+            return false; // failed, or the constraints are unsatisfiable
+    }
+
+    bool holds;
+    if (model) {
+        BatchEvaluator evaluator(query.expr);
+        std::vector<const Assignment *> models(1, model.get());
+        holds = findModel(evaluator, models) != nullptr;
+        // Record the side the model decides, for the queries extending it.
+        std::vector<ref<Expr>> exprs = query.constraints.toVector();
+        exprs.push_back(holds ? query.expr : Expr::createIsZero(query.expr));
+        insert(makeKey(exprs), true, model);
+    } else {
+        // No model to go by: solve one side first. The constraints are
+        // satisfiable, so if this side is not the other one is.
+        if (!isSatisfiable(query, query.expr, holds))
+            return false;
+        if (!holds) {
+            result = Solver::False;
+            return true;
+        }
+    }
+
+    ref<Expr> other = holds ? Expr::createIsZero(query.expr) : query.expr;
+    bool otherHolds;
+    if (!isSatisfiable(query, other, otherHolds))
+        return false;
+    if (otherHolds)
+        result = Solver::Unknown;
+    else
+        result = holds ? Solver::True : Solver::False;
+    return true;
+}
+
+bool CexCachingSolver::computeTruth(const Query &query, bool &isValid) {
+    // The query is valid iff its negation is unsatisfiable.
+    bool satisfiable;
+    if (!isSatisfiable(query, Expr::createIsZero(query.expr), satisfiable))
+        return false;
+    isValid = !satisfiable;
+    return true;
+}
+
+std::unique_ptr<Solver> createCexCachingSolver(std::unique_ptr<Solver> s,
+                                               std::size_t maxCachedConstraints) {
+    return std::make_unique<Solver>(
+        std::make_unique<CexCachingSolver>(std::move(s), maxCachedConstraints));
+}
+
+} // namespace miniklee
@@ -9,18 +9,19 @@ class DummySolverImpl : public SolverImpl {
 public:
     DummySolverImpl();
 
-    bool computeValidity(const Query &);
+    bool computeValidity(const Query &, Solver::Validity &result);
     bool computeTruth(const Query &, bool &isValid);
     bool computeValue(const Query &, ref<Expr> &result);
     bool computeInitialValues(const Query &,
                                 const std::vector<const SymbolicExpr *> &objects,
-                                std::vector<std::vector<int32_t> > &values);
+                                std::vector<std::vector<int32_t> > &values,
+                                bool &hasSolution);
     SolverRunStatus getOperationStatusCode();
 };
 
 DummySolverImpl::DummySolverImpl() {}
 
-bool DummySolverImpl::computeValidity(const Query &) {
+bool DummySolverImpl::computeValidity(const Query &, Solver::Validity &result) {
     return false;
 }
 
@@ -34,7 +35,7 @@ bool DummySolverImpl::computeValue(const Query &, ref<Expr> &result) {
 
 bool DummySolverImpl::computeInitialValues(
     const Query &, const std::vector<const SymbolicExpr *> &objects,
-    std::vector<std::vector<int32_t> > &values) {
+    std::vector<std::vector<int32_t> > &values, bool &hasSolution) {
     return false;
 }
 
@@ -6,20 +6,24 @@
 
 #include "ExecutionState.h"
 
-std::uint32_t ExecutionState::nextID = 1;
+std::atomic<std::uint32_t> ExecutionState::nextID(1);
 
-ExecutionState::ExecutionState(llvm::Function* function)
-    : pc(function->begin()->begin()), prevPC(nullptr) {
+ExecutionState::ExecutionState(KFunction* kf)
+    : kf(kf), pc(kf->entry()), prevPC(nullptr), locals(kf->numRegisters) {
         setID();
 }
 
 ExecutionState::ExecutionState(const ExecutionState& state):
+    kf(state.kf),
     pc(state.pc),
     prevPC(state.prevPC),
     locals(state.locals),
-    constraints(state.constraints) {}
+    constraints(state.constraints),
+    depth(state.depth) {}
 
 ExecutionState *ExecutionState::ExecutionState::branch() {
+    depth++;
+
     auto *falseState = new ExecutionState(*this);
     falseState->setID();
     return falseState;
@@ -10,32 +10,97 @@
 
 #include "Executor.h"
 #include "ExecutionState.h"
+#include "KModule.h"
+#include "Trace.h"
 
 
 using namespace llvm;
 using namespace miniklee;
 
+/// The solvers every executor queries, outermost first.
+static std::unique_ptr<Solver> createSolverChain() {
+    return createCachingSolver(createCexCachingSolver(
+        createIndependentSolver(createFastCexSolver(
+            createCoreSolver(CoreSolverType::TINY_SOLVER)))));
+}
+
+namespace {
+/// How an icmp predicate is lowered: the create function building the
+/// comparison and the message traced for it.
+struct ICmpLowering {
+    ref<Expr> (*create)(const ref<Expr>, const ref<Expr>);
+    const char *trace;
+};
+
+/// The lowering of icmp \p predicate, or null if it is not an integer
+/// comparison.
+const ICmpLowering *getICmpLowering(unsigned predicate) {
+    // In CmpInst::Predicate order.
+    static const ICmpLowering lowerings[] = {
+        {EqExpr::create, "State {} ICMP_EQ comparison"},
+        {NeExpr::create, "State {} ICMP_NE comparison"},
+        {UgtExpr::create, "State {} ICMP_UGT comparison"},
+        {UgeExpr::create, "State {} ICMP_UGE comparison"},
+        {UltExpr::create, "State {} ICMP_ULT comparison"},
+        {UleExpr::create, "State {} ICMP_ULE comparison"},
+        {SgtExpr::create, "State {} ICMP_SGT comparison"},
+        {SgeExpr::create, "State {} ICMP_SGE comparison"},
+        {SltExpr::create, "State {} ICMP_SLT comparison"},
+        {SleExpr::create, "State {} ICMP_SLE comparison"},
+    };
+    static_assert(sizeof(lowerings) / sizeof(lowerings[0]) ==
+                      CmpInst::LAST_ICMP_PREDICATE - CmpInst::FIRST_ICMP_PREDICATE + 1,
+                  "one lowering per icmp predicate");
+    if (predicate < CmpInst::FIRST_ICMP_PREDICATE ||
+        predicate > CmpInst::LAST_ICMP_PREDICATE)
+        return nullptr;
+    return &lowerings[predicate - CmpInst::FIRST_ICMP_PREDICATE];
+}
+} // namespace
+
 Executor::Executor(std::unique_ptr<llvm::Module> module) 
     : module(std::move(module)) {
-    this->solver = createCoreSolver(CoreSolverType::TINY_SOLVER);
+    this->kmodule = std::make_shared<KModule>(this->module.get());
+    this->solver = createSolverChain();
+}
+
+Executor::Executor(std::shared_ptr<KModule> kmodule)
+    : kmodule(std::move(kmodule)) {
+    // Solvers are not thread-safe: every worker gets its own.
+    this->solver = createSolverChain();
+}
+
+std::unique_ptr<Executor> Executor::createWorker() const {
+    return std::unique_ptr<Executor>(new Executor(kmodule));
 }
 
 void Executor::runFunctionAsMain(Function *function) {
-    ExecutionState initialState(function);
-    states.addState(&initialState);
+    KFunction *kf = kmodule->getKFunction(function);
+    ExecutionState *initialState = new ExecutionState(kf);
+
+    if (!searcher)
+        searcher = createSearcher({SearcherType::DFS}, rng);
+
+    addedStates.push_back(initialState);
+    updateStates(nullptr);
+
+    Expr::setDeferredReclamation(true);
 
     // main interpreter loop
-    while (!states.isEmpty()) {
-        // FIXME: Need searcher to choose next state?
-        ExecutionState &state = states.selectState();
+    while (!states.empty()) {
+        ExecutionState &state = searcher->selectState();
 
-        Instruction *i = &*state.pc;
+        KInstIterator ki = state.pc;
         stepInstruction(state);
 
-        executeInstruction(state, i);
+        executeInstruction(state, ki);
 
         updateStates(&state);
+
+        Expr::reclaimPending(ReclaimBudget);
     }
+
+    Expr::setDeferredReclamation(false);
 }
 
 void Executor::stepInstruction(ExecutionState& state) {
@@ -45,208 +110,98 @@ void Executor::stepInstruction(ExecutionState& state) {
     // TODO: Other logic code to handle haltExecution
 }
 
-void Executor::executeInstruction(ExecutionState& state, Instruction* i) {
-    switch (i->getOpcode()) {
+void Executor::executeInstruction(ExecutionState& state, KInstIterator ki) {
+    switch (ki->opcode) {
     // Control flow
     case Instruction::Ret: {
-        errs() << "State " << state.getID() << " Ret\n";
+        MINIKLEE_TRACE(Executor, Debug, "State {} Ret", state.getID());
         // // FIXME: Handle return
         removedStates.push_back(&state);
         break;
     }
     case Instruction::Br: {
-        errs() << "State " << state.getID() << " Br\n";
-        BranchInst *bi = cast<BranchInst>(i);
-        if (bi->isUnconditional()) {
-            transferToBasicBlock(bi->getSuccessor(0), state);
+        MINIKLEE_TRACE(Executor, Debug, "State {} Br", state.getID());
+        if (ki->numOperands == 0) {
+            transferToBasicBlock(ki->successors[0], state);
         } else {
-            assert(bi->getCondition() == bi->getOperand(0) &&
-                    "Wrong operand index!");
-            
-            Instruction *condInstr = dyn_cast<Instruction>(bi->getCondition()); assert(condInstr);
-            ref<Expr> cond = getInstructionValue(state, condInstr); assert(cond);
+            ref<Expr> cond = getValue(state, ki, 0); assert(cond);
 
             Executor::StatePair branches = fork(state, cond);
             if (branches.first)
-                transferToBasicBlock(bi->getSuccessor(0), *branches.first);
+                transferToBasicBlock(ki->successors[0], *branches.first);
             if (branches.second)
-                transferToBasicBlock(bi->getSuccessor(1), *branches.second);
+                transferToBasicBlock(ki->successors[1], *branches.second);
         }
         break;
     }
     case Instruction::Call: {
-        if (isa<DbgInfoIntrinsic>(i))
-            break;
-
-        const CallBase *cb = cast<CallBase>(i);
-        assert(cb->getCalledFunction()->getName() == "make_symbolic"
-                && "Unknown call instruction");
-        assert(cb->arg_size()  == 3 && "Unexpected Error");
-
-        errs() << "State " << state.getID() << " Mk Sym\n";
-        // 1. Make symbolic
-        Instruction *sym = dyn_cast<Instruction>(cb->getArgOperand(0));
-        assert(sym && "First argument should be a variable (Instruction type)");
-
-        // 2. Deal with the size (4 bytes)
-        ConstantInt *size = dyn_cast<ConstantInt>(cb->getArgOperand(1));
-        assert(size->getSExtValue() == Expr::Int32 / CHAR_BIT);
-
-        // 3. Retrieve the name
-        Value *arg = cb->getArgOperand(2); 
-        // GEP constant expression
-        auto *gepExpr = cast<llvm::ConstantExpr>(arg);
-        assert(gepExpr->getOpcode() == llvm::Instruction::GetElementPtr && "GEP Expected");
-        // Get the global variable
-        auto *globalVar = cast<GlobalVariable>(gepExpr->getOperand(0));
-        auto *strArray = cast<ConstantDataArray>(globalVar->getInitializer());
-        assert(strArray->isString() && "String Expected");
-
-        executeMakeSymbolic(state, sym, strArray->getAsString().str());
-
+        MINIKLEE_TRACE(Executor, Debug, "State {} Mk Sym", state.getID());
+        executeMakeSymbolic(state, ki->operands[0],
+                            state.kf->symbolNames[ki->symbolName]);
         break;
     }
     // Memory instructions...
     case Instruction::Alloca: {
         // TODO: remove debug info
-        errs() << "State " << state.getID() << ": Alloca\n";
-        AllocaInst *ai = cast<AllocaInst>(i);
-        assert("Support Int32 type only" 
-                && ai->getAllocatedType() == Type::getInt32Ty(i->getContext()));
-        const DataLayout &dataLayout = module->getDataLayout();
-        unsigned sizeInBits = dataLayout.getTypeSizeInBits(ai->getAllocatedType());
-        executeAlloc(state, sizeInBits, i);
+        MINIKLEE_TRACE(Executor, Debug, "State {}: Alloca", state.getID());
+        // The allocated type was checked to be Int32 while decoding.
+        executeAlloc(state, Expr::Int32, ki);
         break;
     }
 
     case Instruction::Load: {
-        errs() << "State " << state.getID() << " Load\n";
-        LoadInst *li = cast<LoadInst>(i);
-        
-        Instruction *address = dyn_cast<Instruction>(li->getPointerOperand());
-        assert(address && "Pointer Operand expected");
-
-        executeMemoryOperation(state, false, address, 0, li /* simply the Load instr itself */);
+        MINIKLEE_TRACE(Executor, Debug, "State {} Load", state.getID());
+        executeMemoryOperation(state, false, ki->operands[0], 0, ki->dest);
         break;
     }
 
     case Instruction::Store: {
-        errs() << "State " << state.getID() << " Store\n";
-        StoreInst *si = cast<StoreInst>(i);
-        // Retrieve the target address
-        Instruction *target = dyn_cast<Instruction>(si->getOperand(1));
-        if (!target)
-            assert(false && "Target is not an Instruction");
-        // Retrieve the value to be stored
-        Value *value = si->getValueOperand();
-
-        if (ConstantInt *ci = dyn_cast<ConstantInt>(value)) {
-            // Deal with constant, just assign value
-            assert(ci->getType()->isIntegerTy(32) && "Int32 expected");
-            int32_t rawInt32Value = static_cast<int32_t>(ci->getSExtValue());
-            ref<miniklee::ConstantExpr> int32Value = miniklee::ConstantExpr::alloc(rawInt32Value, Expr::Int32);
-            executeMemoryOperation(state, true, target, int32Value, 0);
-        } else {
-            // Deal with pointer, then fetch pointed and assign
-            Instruction *ptr = dyn_cast<Instruction>(value); assert(ptr);
-            ref<Expr> pointed = getInstructionValue(state, ptr);
-
-            assert(pointed && "No coresponding symblic value found for pointer!");
-            executeMemoryOperation(state, true, target, pointed, 0);
-        }
-
+        MINIKLEE_TRACE(Executor, Debug, "State {} Store", state.getID());
+        // Constants were materialized while decoding, so both cases
+        // reduce to fetching the operand.
+        ref<Expr> value = getValue(state, ki, 0);
+        assert(value && "No coresponding symblic value found for pointer!");
+        executeMemoryOperation(state, true, ki->operands[1], value,
+                               KInstruction::NoRegister);
         break;
     }
 
     // Arithmetic
     case Instruction::Add: {
-        errs() << "State " << state.getID() << " Add\n";
-        BinaryOperator *ao = cast<BinaryOperator>(i);
-
-        ref<Expr> lshValue = getValue(state, ao->getOperand(0));
-        ref<Expr> rshValue = getValue(state, ao->getOperand(1));
+        MINIKLEE_TRACE(Executor, Debug, "State {} Add", state.getID());
+        ref<Expr> lshValue = getValue(state, ki, 0);
+        ref<Expr> rshValue = getValue(state, ki, 1);
         ref<Expr> add = AddExpr::create(lshValue, rshValue);
 
-        executeMemoryOperation(state, true, i /* simply the Load instr itself */, add, 0);
+        executeMemoryOperation(state, true, ki->dest, add, KInstruction::NoRegister);
         break;
     }
 
     case Instruction::Sub: {
-        errs() << "State " << state.getID() << " Sub\n";
-        BinaryOperator *ao = cast<BinaryOperator>(i);
-
-        ref<Expr> lshValue = getValue(state, ao->getOperand(0));
-        ref<Expr> rshValue = getValue(state, ao->getOperand(1));
+        MINIKLEE_TRACE(Executor, Debug, "State {} Sub", state.getID());
+        ref<Expr> lshValue = getValue(state, ki, 0);
+        ref<Expr> rshValue = getValue(state, ki, 1);
         ref<Expr> sub = SubExpr::create(lshValue, rshValue);
 
-        executeMemoryOperation(state, true, i /* simply the Load instr itself */, sub, 0);
+        executeMemoryOperation(state, true, ki->dest, sub, KInstruction::NoRegister);
         break;
     }
 
     // Compare
     case Instruction::ICmp: {
-        CmpInst *ci = cast<CmpInst>(i);
-        ICmpInst *ii = cast<ICmpInst>(ci);
-
-        switch(ii->getPredicate()) {
-        case ICmpInst::ICMP_EQ: {
-            errs() << "State " << state.getID() << " ICMP_EQ comparison\n";
-            ref<Expr> lshValue = getValue(state, ii->getOperand(0));
-            ref<Expr> rshValue = getValue(state, ii->getOperand(1));
-            ref<Expr> eq = EqExpr::create(lshValue, rshValue);
-
-            executeMemoryOperation(state, true, ii, eq, 0);
-            break;
-        }
-        case ICmpInst::ICMP_NE: {
-            assert(false && "TODO: ICMP_NE comparison");
-            break;
-        }
-        case ICmpInst::ICMP_UGT: {
-            assert(false && "TODO: ICMP_UGT comparison");
-            break;
-        }
-        case ICmpInst::ICMP_UGE: {
-            assert(false && "TODO: ICMP_UGE comparison");
-            break;
-        }
-        case ICmpInst::ICMP_ULT: {
-            assert(false && "TODO: ICMP_ULT comparison");
-            break;
-        }
-        case ICmpInst::ICMP_ULE: {
-            assert(false && "TODO: ICMP_ULE comparison");
-            break;
-        }
-        case ICmpInst::ICMP_SGT: {
-            assert(false && "TODO: ICMP_SGT comparison");
-            break;
-        }
-        case ICmpInst::ICMP_SGE: {
-            assert(false && "TODO: ICMP_SGE comparison");
-            break;
-        }
-        case ICmpInst::ICMP_SLT: {
-            errs() << "State " << state.getID() << " ICMP_SLT comparison\n";
-            ref<Expr> lshValue = getValue(state, ii->getOperand(0));
-            ref<Expr> rshValue = getValue(state, ii->getOperand(1));
-            ref<Expr> slt = SltExpr::create(lshValue, rshValue);
-
-            executeMemoryOperation(state, true, ii, slt, 0);
-            break;
-        }
-        case ICmpInst::ICMP_SLE: {
-            assert(false && "TODO: ICMP_SLE comparison");
-            break;
-        }
-        default:
-            assert(false && " Unknown comparison. TODO: Use terminateStateOnExecError to finish.");
-        }
+        const ICmpLowering *lowering = getICmpLowering(ki->predicate);
+        assert(lowering && " Unknown comparison. TODO: Use terminateStateOnExecError to finish.");
+        MINIKLEE_TRACE(Executor, Debug, lowering->trace, state.getID());
+        ref<Expr> lshValue = getValue(state, ki, 0);
+        ref<Expr> rshValue = getValue(state, ki, 1);
+        ref<Expr> result = lowering->create(lshValue, rshValue);
+
+        executeMemoryOperation(state, true, ki->dest, result, KInstruction::NoRegister);
         break;
     }
     
     default:
-        errs() << "Unknown instruction: " << *i << "\n";
+        errs() << "Unknown instruction: " << *ki->inst << "\n";
         assert(false && "Unknown instruction");
         break;
     }
@@ -254,118 +209,99 @@ void Executor::executeInstruction(ExecutionState& state, Instruction* i) {
 }
 
 void Executor::updateStates(ExecutionState *current)  {
-    // std::cout << GREY_TEXT("Updating states") << std::endl;
-    assert(current);
+    searcher->update(current, addedStates, removedStates);
 
-    states.addState(addedStates.begin(), addedStates.end());
+    states.insert(addedStates.begin(), addedStates.end());
     addedStates.clear();
 
-    for (std::vector<ExecutionState *>::iterator it = removedStates.begin(),
-                                                ie = removedStates.end();
-        it != ie; ++it) {
-        ExecutionState *es = *it;
-        std::deque<ExecutionState*>::iterator it2 = states.find(es);
-        assert(it2 != states.end());
-
-        states.erase(it2);
+    for (ExecutionState *es : removedStates) {
+        auto it = states.find(es);
+        assert(it != states.end());
+        states.erase(it);
+        delete es;
+        ++pathsExplored;
     }
     removedStates.clear();
 }
 
-void Executor::transferToBasicBlock(BasicBlock *dst, ExecutionState &state) {
-    state.pc = dst->begin();
+void Executor::transferToBasicBlock(unsigned entry, ExecutionState &state) {
+    state.pc = state.kf->at(entry);
 }
 
 
-void Executor::executeAlloc(ExecutionState& state, unsigned size, Instruction* inst) {
-    assert("Only Support Int32"
-        && size == Type::getInt32Ty(inst->getContext())->getPrimitiveSizeInBits());
+void Executor::executeAlloc(ExecutionState& state, unsigned size, KInstIterator ki) {
+    assert("Only Support Int32" && size == Expr::Int32);
     // WARNING: Dangling pointer?
     //          Maybe we should refactor the ConstantExpr to be more specific
-    state.locals.insert({inst, miniklee::InvalidKindExpr::create(0, size)});
+    state.locals.set(ki->dest, miniklee::InvalidKindExpr::create(0, size));
 }
 
-ref<Expr> Executor::getInstructionValue(ExecutionState& state, Instruction* i) {
-    // return state.locals.find(i)->second;
-    auto it = state.locals.find(i);
-    if (it != state.locals.end()) {
-        return it->second;
-    } else {
-        return nullptr;
-    }
+ref<Expr> Executor::getInstructionValue(ExecutionState& state, unsigned reg) {
+    assert(reg < state.locals.size() && "Invalid register");
+    return state.locals[reg];
 }
 
 
 void Executor::executeMemoryOperation(ExecutionState& state, 
                             bool isWrite, 
-                            Instruction *address,
+                            unsigned address,
                             ref<Expr> value, /* undef if read */
-                            Instruction* target /* undef if wirte*/) {
+                            unsigned target /* undef if wirte*/) {
+    assert(address < state.locals.size() && "Invalid register");
     if (isWrite) { // Interpret the Store instruction
         // WARNING: Check whether override the latent value?
-        assert(!target);
-        auto it = state.locals.find(address);
-        if (it != state.locals.end()) {
-            state.locals.erase(it);
-        }
-        state.locals.insert({address, value});
+        assert(target == KInstruction::NoRegister);
+        state.locals.set(address, std::move(value));
     } else { // Interpret the Load instruction
         assert(!value);
-        // FIXME: Wrap a set of APIs
-        auto loadedValue = state.locals.find(address);
-        if (loadedValue == state.locals.end()) {
-            assert(false && "Unexpected Error");
-        } else {
-            auto it = state.locals.find(target);
-            if (it != state.locals.end()) {
-                state.locals.erase(it);
-            }
-            state.locals.insert({target, loadedValue->second});
-        }
+        assert(target < state.locals.size() && "Invalid register");
+        assert(state.locals[address] && "Unexpected Error");
+        state.locals.set(target, state.locals[address]);
     }
 }
 
-ref<Expr> Executor::getValue(ExecutionState& state, Value* value) {
-    if (Instruction *v= dyn_cast<Instruction>(value)) {
-        ref<Expr> rawValue = getInstructionValue(state, v);
-        assert(rawValue && "Value Not Stored");
-        return rawValue;
-    } else if (ConstantInt *constValue = dyn_cast<ConstantInt>(value)) {
-        return miniklee::ConstantExpr::create(
-            static_cast<int32_t>(constValue->getSExtValue()),
-            Expr::Int32);
-    } else {
-        assert(false && "Unexpected Error");
-    }
+ref<Expr> Executor::getValue(ExecutionState& state, KInstIterator ki, unsigned index) {
+    int op = ki->operands[index];
+    if (KInstruction::isConstantOperand(op))
+        return state.kf->constants[KInstruction::constantIndex(op)];
 
+    ref<Expr> rawValue = getInstructionValue(state, op);
+    assert(rawValue && "Value Not Stored");
+    return rawValue;
 }
 
-void Executor::executeMakeSymbolic(ExecutionState& state, Instruction *symAddress, std::string name) {
+void Executor::executeMakeSymbolic(ExecutionState& state, unsigned symAddress, const std::string &name) {
     // Register the variable (Instruction type) to be symbolic
-    executeMemoryOperation(state, true, symAddress, SymbolicExpr::create(name), 0);
+    executeMemoryOperation(state, true, symAddress, SymbolicExpr::create(name),
+                           KInstruction::NoRegister);
 }
 
 
 Executor::StatePair Executor::fork(ExecutionState &current,
                                     ref<Expr> condition) {
-    // Invoke solver to determinie the feasibility of the condition
-    bool trueBranch = this->solver->evaluate(Query(current.constraints, condition));
-    bool falseBranch = this->solver->evaluate(Query(current.constraints, NotExpr::create(condition)));
+    // Invoke solver to determine which sides of the condition are feasible
+    Solver::Validity res;
+    if (!this->solver->evaluate(Query(current.constraints, condition), res))
+        llvm::report_fatal_error("solver failure at fork");
 
-    if (trueBranch && !falseBranch /* Solver::True */) {
+    switch (res) {
+    case Solver::True:
         return StatePair(&current, nullptr);
-    } else if (!trueBranch && falseBranch /* Solver::False */) {
+    case Solver::False:
         return StatePair(nullptr, &current);
-    } else if (trueBranch && falseBranch /* Solver::Unknown */ ) {
+    default: {
         ExecutionState *falseState, *trueState = &current;
         falseState = trueState->branch();
         addedStates.push_back(falseState);
+        MINIKLEE_TRACE(Fork, Info, "State {} forked State {} at depth {}",
+                       trueState->getID(), falseState->getID(), trueState->depth);
 
         addConstraint(*trueState, condition);
         addConstraint(*falseState, NotExpr::create(condition));
 
         return StatePair(trueState, falseState);
-    } else { assert(false && "Unexpected Error"); }
+    }
+    }
 }
 
 void Executor::addConstraint(ExecutionState &state, ref<Expr> condition) {
@@ -1,10 +1,14 @@
 #include "Expr.h"
+#include "LinearForm.h"
 #include "llvm/Support/Casting.h"
 
+#include <mutex>
+#include <unordered_map>
+
 using namespace miniklee;
 
 
-unsigned Expr::count = 0;
+std::atomic<unsigned> Expr::count(0);
 
 void Expr::printKind(llvm::raw_ostream &os, Kind k) {
     switch(k) {
@@ -32,52 +36,279 @@ void Expr::printKind(llvm::raw_ostream &os, Kind k) {
     }
 }
 
-unsigned Expr::computeHash() {
-    unsigned res = getKind() * Expr::MAGIC_HASH_CONSTANT;
+std::uint64_t Expr::computeHash() {
+    hashValue = ExprKey::of(*this).hash();
+    return hashValue;
+}
+
+int Expr::compare(const Expr &b) const {
+    const Expr *x = this;
+    const Expr *y = &b;
+    // Follow the last differing kid iteratively, the others recursively:
+    // canonical chains nest on the right.
+    while (x != y) {
+        Kind xk = x->getKind(), yk = y->getKind();
+        if (xk != yk)
+            return xk < yk ? -1 : 1;
+        Width xw = x->getWidth(), yw = y->getWidth();
+        if (xw != yw)
+            return xw < yw ? -1 : 1;
+        if (x->hashValue != y->hashValue)
+            return x->hashValue < y->hashValue ? -1 : 1;
+        if (int c = x->compareContents(*y))
+            return c;
 
-    int n = getNumKids();
-    for (int i = 0; i < n; i++) {
-        res <<= 1;
-        res ^= getKid(i)->hash() * Expr::MAGIC_HASH_CONSTANT;
+        unsigned n = x->getNumKids();
+        unsigned last = n;
+        for (unsigned i = 0; i < n; ++i) {
+            if (x->getKid(i).get() == y->getKid(i).get())
+                continue;
+            if (last != n) {
+                if (int c = x->getKid(last)->compare(*y->getKid(last)))
+                    return c;
+            }
+            last = i;
+        }
+        if (last == n)
+            return 0;
+        x = x->getKid(last).get();
+        y = y->getKid(last).get();
     }
-    
-    hashValue = res;
-    return hashValue;
+    return 0;
 }
 
-unsigned ConstantExpr::computeHash() {
-    Expr::Width w = getWidth();
-    if (w <= 64)
-        hashValue = value.getLimitedValue() ^ (w * MAGIC_HASH_CONSTANT);
-    else
-        hashValue = hash_value(value) ^ (w * MAGIC_HASH_CONSTANT);
+ExprKey ExprKey::of(const Expr &e) {
+    switch (e.getKind()) {
+    case Expr::Constant: {
+        const ConstantExpr *ce = cast<ConstantExpr>(&e);
+        if (ce->isWide())
+            return ExprKey(Expr::Constant, ce->getAPValue());
+        return ExprKey(Expr::Constant, ce->getZExtValue(), ce->getWidth());
+    }
+    case Expr::InvalidKind: {
+        const InvalidKindExpr *ie = cast<InvalidKindExpr>(&e);
+        if (ie->isWide())
+            return ExprKey(Expr::InvalidKind, ie->getAPValue());
+        return ExprKey(Expr::InvalidKind, ie->getZExtValue(), ie->getWidth());
+    }
+    case Expr::Symbolic:
+        return ExprKey(Expr::Symbolic, cast<SymbolicExpr>(&e)->getSymbol());
+    case Expr::Not:
+        return ExprKey(Expr::Not, e.getWidth(), cast<NotExpr>(&e)->expr.get());
+    default: {
+        const BinaryExpr *be = cast<BinaryExpr>(&e);
+        return ExprKey(e.getKind(), e.getWidth(), be->left.get(), be->right.get());
+    }
+    }
+}
 
-    return hashValue;
+std::uint64_t ExprKey::hash() const {
+    std::uint64_t h = hashCombine(static_cast<std::uint64_t>(kind - Expr::InvalidKind), width);
+    switch (kind) {
+    case Expr::Constant:
+    case Expr::InvalidKind:
+        if (width <= 64)
+            return hashCombine(h, bits);
+        for (unsigned i = 0; i < value.getNumWords(); ++i)
+            h = hashCombine(h, value.getRawData()[i]);
+        return h;
+    case Expr::Symbolic:
+        return hashCombine(h, symbol->hash);
+    default:
+        for (const Expr *kid : kids)
+            if (kid)
+                h = hashCombine(h, kid->hash());
+        return h;
+    }
 }
 
-unsigned InvalidKindExpr::computeHash() {
-    Expr::Width w = getWidth();
-    if (w <= 64)
-        hashValue = value.getLimitedValue() ^ (w * MAGIC_HASH_CONSTANT);
-    else
-        hashValue = hash_value(value) ^ (w * MAGIC_HASH_CONSTANT);
+bool ExprKey::operator==(const ExprKey &b) const {
+    if (kind != b.kind || width != b.width ||
+        kids[0] != b.kids[0] || kids[1] != b.kids[1])
+        return false;
+    switch (kind) {
+    case Expr::Constant:
+    case Expr::InvalidKind:
+        return width <= 64 ? bits == b.bits : value == b.value;
+    case Expr::Symbolic:
+        return symbol == b.symbol;
+    default:
+        return true;
+    }
+}
 
-    return hashValue;
+/// The global unique table behind Expr::intern, split by hash into shards
+/// with a lock each so threads building unrelated expressions rarely
+/// contend. Entries keep a copy of their key, so probing never reads a
+/// node that may be mid-destruction; a node whose count already dropped to
+/// zero is skipped and evicts itself from its destructor.
+namespace {
+struct UniqueShard {
+    std::mutex lock;
+    std::unordered_multimap<std::uint64_t, std::pair<ExprKey, Expr *>> entries;
+};
+
+const unsigned UniqueShardBits = 6;
+
+UniqueShard &getUniqueShard(std::uint64_t hash) {
+    // Never destroyed: nodes may still die during static destruction.
+    static UniqueShard *shards = new UniqueShard[1u << UniqueShardBits];
+    // The maps bucket on the low bits; pick the shard with the high ones.
+    return shards[hash >> (64 - UniqueShardBits)];
+}
+} // namespace
+
+ref<Expr> Expr::internNode(const ExprKey &key, llvm::function_ref<Expr *()> make) {
+    std::uint64_t h = key.hash();
+    UniqueShard &shard = getUniqueShard(h);
+    // Look up and insert under one acquisition. Building the node here is
+    // safe: constructors only take references to existing kids.
+    std::lock_guard<std::mutex> guard(shard.lock);
+    auto range = shard.entries.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second.first == key)
+            if (ref<Expr> e = ref<Expr>::tryAcquire(it->second.second))
+                return e;
+    }
+    ref<Expr> node(make());
+    node->hashValue = h;
+    node->interned = true;
+    shard.entries.emplace(h, std::make_pair(key, node.get()));
+    return node;
 }
 
-unsigned SymbolicExpr::computeHash() {
-    Expr::Width w = getWidth();
+void Expr::evict() {
+    UniqueShard &shard = getUniqueShard(hashValue);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    auto range = shard.entries.equal_range(hashValue);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second.second == this) {
+            shard.entries.erase(it);
+            return;
+        }
+    }
+}
 
-    // Hash the string using std::hash and combine with MAGIC_HASH_CONSTANT
-    std::hash<std::string> hashFn;
-    hashValue = hashFn(name) ^ (w * MAGIC_HASH_CONSTANT);
+/// Per-thread queue of nodes waiting to be deleted. A node with a zero
+/// count stays in the unique table until it is deleted, but lookups skip
+/// it, so queued nodes are never handed out again.
+namespace {
+struct Reclaimer {
+    std::vector<Expr *> pending;
+    bool draining = false;
+    bool deferred = false;
+};
 
-    return hashValue;
+thread_local Reclaimer *localReclaimer = nullptr;
+thread_local bool localReclaimerRetired = false;
+
+/// Drains the queue and retires it when the thread exits.
+struct ReclaimerGuard {
+    ~ReclaimerGuard() {
+        if (localReclaimer) {
+            localReclaimer->deferred = false;
+            Expr::reclaimPending();
+            delete localReclaimer;
+        }
+        localReclaimer = nullptr;
+        localReclaimerRetired = true;
+    }
+};
+
+Reclaimer *getReclaimer() {
+    if (localReclaimer)
+        return localReclaimer;
+    if (localReclaimerRetired)
+        return nullptr;
+
+    thread_local ReclaimerGuard guard;
+    (void) guard;
+
+    localReclaimer = new Reclaimer();
+    return localReclaimer;
 }
+} // namespace
 
-unsigned NotExpr::computeHash() {
-    hashValue = expr->hash() * Expr::MAGIC_HASH_CONSTANT * Expr::Not;
-    return hashValue;
+void Expr::reclaim(Expr *e) {
+    Reclaimer *r = getReclaimer();
+    if (!r) {
+        // Thread teardown: the queue is gone, free directly.
+        delete e;
+        return;
+    }
+    r->pending.push_back(e);
+    if (!r->draining && !r->deferred)
+        reclaimPending();
+}
+
+void Expr::setDeferredReclamation(bool enabled) {
+    if (Reclaimer *r = getReclaimer()) {
+        r->deferred = enabled;
+        if (!enabled)
+            reclaimPending();
+    }
+}
+
+std::size_t Expr::reclaimPending(std::size_t budget) {
+    Reclaimer *r = getReclaimer();
+    if (!r || r->draining)
+        return r ? r->pending.size() : 0;
+
+    r->draining = true;
+    for (; budget > 0 && !r->pending.empty(); --budget) {
+        Expr *e = r->pending.back();
+        r->pending.pop_back();
+        delete e;
+    }
+    r->draining = false;
+    return r->pending.size();
+}
+
+/// Bool constants and Int32 constants in [InternedMin, InternedMax] are
+/// preallocated once and handed out as immortal references, so concrete
+/// execution (loop counters, small literals) never allocates and never
+/// touches a reference count.
+static const int64_t InternedMin = -256;
+static const int64_t InternedMax = 1023;
+
+ConstantExpr *ConstantExpr::getInterned(std::uint64_t v, Width w) {
+    struct Table {
+        std::vector<ConstantExpr *> bools;
+        std::vector<ConstantExpr *> ints;
+
+        static ConstantExpr *make(std::uint64_t v, Width w) {
+            ConstantExpr *ce = new ConstantExpr(v, w);
+            ce->computeHash();
+            ce->_refCount.pin();
+            return ce;
+        }
+
+        Table() {
+            for (uint64_t b = 0; b <= 1; ++b)
+                bools.push_back(make(b, Expr::Bool));
+            for (int64_t i = InternedMin; i <= InternedMax; ++i)
+                ints.push_back(make(i, Expr::Int32));
+        }
+    };
+    static const Table table;
+
+    switch (w) {
+    case Expr::Bool:
+        return table.bools[v];
+    case Expr::Int32: {
+        int64_t i = llvm::SignExtend64(v, Expr::Int32);
+        if (InternedMin <= i && i <= InternedMax)
+            return table.ints[i - InternedMin];
+        return nullptr;
+    }
+    default:
+        return nullptr;
+    }
+}
+
+InvalidKindExpr *InvalidKindExpr::getInterned(std::uint64_t v, Width w) {
+    // Placeholders are not interned.
+    return nullptr;
 }
 
 void Expr::printWidth(llvm::raw_ostream &os, Width width) {
@@ -89,73 +320,318 @@ void Expr::printWidth(llvm::raw_ostream &os, Width width) {
 }
 
 ref<ConstantExpr> ConstantExpr::Not() {
-    return ConstantExpr::alloc(~value);
+    if (isWide())
+        return ConstantExpr::alloc(~*wide);
+    return ConstantExpr::alloc(~bits, getWidth());
+}
+
+/// Canonical form, as produced by the create functions below:
+///  - constants are folded, and otherwise go on the left of commutative
+///    operators and comparisons;
+///  - a linear sum of symbols is collapsed into c + (k1 * x1 + (x2 + ...)),
+///    one term per symbol in symbol id order (see LinearForm::toExpr);
+///  - otherwise a sum carries at most one constant, hoisted to the top:
+///    c + (x + y);
+///  - x - c is written -c + x, and x + 0, x - x, x * 1 and Not(Not x) vanish;
+///  - Eq(c, x + c2) becomes Eq(c - c2, x);
+///  - only Eq, Ult, Ule, Slt and Sle are built: Ne becomes Not(Eq) and the
+///    greater-than comparisons swap their operands.
+/// Kids are canonical and hash-consed, so structural equality is pointer
+/// equality.
+namespace {
+ConstantExpr *getConstant(const ref<Expr> &e) {
+    return dyn_cast<ConstantExpr>(e.get());
+}
+
+ConstantExpr *getConstantLeft(const ref<Expr> &e) {
+    const BinaryExpr *be = dyn_cast<BinaryExpr>(e.get());
+    return be ? getConstant(be->left) : nullptr;
+}
+
+/// Evaluate \p k over two wide constants, or return null when the result
+/// is undefined (division by zero, signed division overflow).
+ref<Expr> foldWide(Expr::Kind k, const ConstantExpr *l, const ConstantExpr *r) {
+    llvm::APInt a = l->getAPValue();
+    llvm::APInt b = r->getAPValue();
+    switch (k) {
+    case Expr::Add:  return ConstantExpr::alloc(a + b);
+    case Expr::Sub:  return ConstantExpr::alloc(a - b);
+    case Expr::Mul:  return ConstantExpr::alloc(a * b);
+    case Expr::UDiv:
+        if (b.isZero())
+            return ref<Expr>();
+        return ConstantExpr::alloc(a.udiv(b));
+    case Expr::SDiv:
+        if (b.isZero() || (a.isMinSignedValue() && b.isAllOnes()))
+            return ref<Expr>();
+        return ConstantExpr::alloc(a.sdiv(b));
+    case Expr::Eq:   return ConstantExpr::alloc(a == b, Expr::Bool);
+    case Expr::Ult:  return ConstantExpr::alloc(a.ult(b), Expr::Bool);
+    case Expr::Ule:  return ConstantExpr::alloc(a.ule(b), Expr::Bool);
+    case Expr::Slt:  return ConstantExpr::alloc(a.slt(b), Expr::Bool);
+    case Expr::Sle:  return ConstantExpr::alloc(a.sle(b), Expr::Bool);
+    default:
+        assert(0 && "not a canonical binary kind");
+        return ref<Expr>();
+    }
+}
+
+/// Evaluate \p k over two constants, or return null when the result is
+/// undefined (division by zero, signed division overflow). Constants of
+/// up to 64 bits are folded on their inline values; alloc truncates the
+/// result to the width.
+ref<Expr> fold(Expr::Kind k, const ConstantExpr *l, const ConstantExpr *r) {
+    if (l->isWide())
+        return foldWide(k, l, r);
+
+    Expr::Width w = l->getWidth();
+    std::uint64_t a = l->getZExtValue(), b = r->getZExtValue();
+    std::int64_t sa = l->getSExtValue(), sb = r->getSExtValue();
+    switch (k) {
+    case Expr::Add:  return ConstantExpr::alloc(a + b, w);
+    case Expr::Sub:  return ConstantExpr::alloc(a - b, w);
+    case Expr::Mul:  return ConstantExpr::alloc(a * b, w);
+    case Expr::UDiv:
+        if (b == 0)
+            return ref<Expr>();
+        return ConstantExpr::alloc(a / b, w);
+    case Expr::SDiv:
+        if (b == 0 || (sb == -1 && sa == llvm::minIntN(w)))
+            return ref<Expr>();
+        return ConstantExpr::alloc(static_cast<std::uint64_t>(sa / sb), w);
+    case Expr::Eq:   return ConstantExpr::alloc(a == b, Expr::Bool);
+    case Expr::Ult:  return ConstantExpr::alloc(a < b, Expr::Bool);
+    case Expr::Ule:  return ConstantExpr::alloc(a <= b, Expr::Bool);
+    case Expr::Slt:  return ConstantExpr::alloc(sa < sb, Expr::Bool);
+    case Expr::Sle:  return ConstantExpr::alloc(sa <= sb, Expr::Bool);
+    default:
+        assert(0 && "not a canonical binary kind");
+        return ref<Expr>();
+    }
 }
+} // namespace
 
 ref<Expr> NotExpr::create(const ref<Expr> e) {
-    if (ConstantExpr *CE = llvm::dyn_cast<ConstantExpr>(e.get())) {
+    if (ConstantExpr *CE = getConstant(e))
         return CE->Not();
-    }
-    
+
+    if (NotExpr *NE = dyn_cast<NotExpr>(e.get()))
+        return NE->expr;
+
     return NotExpr::alloc(e);
 }
 
 ref<Expr> AddExpr::create(const ref<Expr> l, const ref<Expr> r) {
-    auto probeLhs = dyn_cast<ConstantExpr>(l.get());
-    auto probeRhs = dyn_cast<ConstantExpr>(r.get());
+    ConstantExpr *cl = getConstant(l);
+    ConstantExpr *cr = getConstant(r);
+
+    if (cl && cr)
+        return fold(Add, cl, cr);
+    if (ref<Expr> sum = LinearForm::combine(Add, l, r))
+        return sum;
+    if (cr)
+        return AddExpr::create(r, l);
 
-    if (probeLhs && probeRhs) {
-        return ConstantExpr::create(
-            probeLhs->getAPValue().getSExtValue() + probeRhs->getAPValue().getSExtValue(),
-            Expr::Int32
-        );
+    if (cl) {
+        if (cl->isZero())
+            return r;
+        // c1 + (c2 + x) == (c1 + c2) + x
+        if (isa<AddExpr>(r.get()) && getConstantLeft(r))
+            return AddExpr::create(AddExpr::create(l, r->getKid(0)), r->getKid(1));
+        // c1 + (c2 - x) == (c1 + c2) - x
+        if (isa<SubExpr>(r.get()) && getConstantLeft(r))
+            return SubExpr::create(AddExpr::create(l, r->getKid(0)), r->getKid(1));
+        return AddExpr::alloc(l, r);
     }
-    
+
+    // (c + x) + y == c + (x + y)
+    if (isa<AddExpr>(l.get()) && getConstantLeft(l))
+        return AddExpr::create(l->getKid(0), AddExpr::create(l->getKid(1), r));
+    // x + (c + y) == c + (x + y)
+    if (isa<AddExpr>(r.get()) && getConstantLeft(r))
+        return AddExpr::create(r->getKid(0), AddExpr::create(l, r->getKid(1)));
+
     return AddExpr::alloc(l, r);
 }
 
 ref<Expr> SubExpr::create(const ref<Expr> l, const ref<Expr> r) {
-    auto probeLhs = dyn_cast<ConstantExpr>(l.get());
-    auto probeRhs = dyn_cast<ConstantExpr>(r.get());
+    ConstantExpr *cl = getConstant(l);
+    ConstantExpr *cr = getConstant(r);
 
-    if (probeLhs && probeRhs) {
-        return ConstantExpr::create(
-            probeLhs->getAPValue().getSExtValue() - probeRhs->getAPValue().getSExtValue(),
-            Expr::Int32
-        );
+    if (cl && cr)
+        return fold(Sub, cl, cr);
+    if (ref<Expr> sum = LinearForm::combine(Sub, l, r))
+        return sum;
+    if (l.get() == r.get())
+        return ConstantExpr::alloc(0, l->getWidth());
+    // x - c == -c + x
+    if (cr)
+        return AddExpr::create(ConstantExpr::alloc(-cr->getAPValue()), l);
+
+    if (cl) {
+        // c1 - (c2 + x) == (c1 - c2) - x
+        if (isa<AddExpr>(r.get()) && getConstantLeft(r))
+            return SubExpr::create(SubExpr::create(l, r->getKid(0)), r->getKid(1));
+        // c1 - (c2 - x) == (c1 - c2) + x
+        if (isa<SubExpr>(r.get()) && getConstantLeft(r))
+            return AddExpr::create(SubExpr::create(l, r->getKid(0)), r->getKid(1));
+        return SubExpr::alloc(l, r);
     }
-    
+
+    // (c + x) - y == c + (x - y)
+    if (isa<AddExpr>(l.get()) && getConstantLeft(l))
+        return AddExpr::create(l->getKid(0), SubExpr::create(l->getKid(1), r));
+    // x - (c + y) == -c + (x - y)
+    if (isa<AddExpr>(r.get()) && getConstantLeft(r))
+        return SubExpr::create(SubExpr::create(l, r->getKid(1)), r->getKid(0));
+
     return SubExpr::alloc(l, r);
 }
 
-ref<Expr> SltExpr::create(const ref<Expr> l, const ref<Expr> r) {
-    auto probeLhs = dyn_cast<ConstantExpr>(l.get());
-    auto probeRhs = dyn_cast<ConstantExpr>(r.get());
+ref<Expr> MulExpr::create(const ref<Expr> l, const ref<Expr> r) {
+    ConstantExpr *cl = getConstant(l);
+    ConstantExpr *cr = getConstant(r);
+
+    if (cl && cr)
+        return fold(Mul, cl, cr);
+    if (ref<Expr> sum = LinearForm::combine(Mul, l, r))
+        return sum;
+    if (cr)
+        return MulExpr::create(r, l);
 
-    if (probeLhs && probeRhs) {
-        return ConstantExpr::create(
-            probeLhs->getAPValue().getSExtValue() < probeRhs->getAPValue().getSExtValue(),
-            Expr::Int32
-        );
+    if (cl) {
+        if (cl->isZero())
+            return l;
+        if (cl->isOne())
+            return r;
+        // c1 * (c2 * x) == (c1 * c2) * x
+        if (isa<MulExpr>(r.get()) && getConstantLeft(r))
+            return MulExpr::create(MulExpr::create(l, r->getKid(0)), r->getKid(1));
     }
-    
-    return SltExpr::alloc(l, r);
+
+    return MulExpr::alloc(l, r);
+}
+
+ref<Expr> UDivExpr::create(const ref<Expr> l, const ref<Expr> r) {
+    ConstantExpr *cl = getConstant(l);
+    ConstantExpr *cr = getConstant(r);
+
+    if (cl && cr)
+        if (ref<Expr> folded = fold(UDiv, cl, cr))
+            return folded;
+    if (cr && cr->isOne())
+        return l;
+
+    return UDivExpr::alloc(l, r);
+}
+
+ref<Expr> SDivExpr::create(const ref<Expr> l, const ref<Expr> r) {
+    ConstantExpr *cl = getConstant(l);
+    ConstantExpr *cr = getConstant(r);
+
+    if (cl && cr)
+        if (ref<Expr> folded = fold(SDiv, cl, cr))
+            return folded;
+    if (cr && cr->isOne())
+        return l;
+
+    return SDivExpr::alloc(l, r);
 }
 
 ref<Expr> EqExpr::create(const ref<Expr> l, const ref<Expr> r) {
-    auto probeLhs = dyn_cast<ConstantExpr>(l.get());
-    auto probeRhs = dyn_cast<ConstantExpr>(r.get());
+    ConstantExpr *cl = getConstant(l);
+    ConstantExpr *cr = getConstant(r);
+
+    if (cl && cr)
+        return fold(Eq, cl, cr);
+    if (l.get() == r.get())
+        return ConstantExpr::alloc(1, Bool);
+    if (cr)
+        return EqExpr::create(r, l);
 
-    if (probeLhs && probeRhs) {
-        return ConstantExpr::create(
-            probeLhs->getAPValue().getSExtValue() == probeRhs->getAPValue().getSExtValue(),
-            Expr::Int32
-        );
+    if (cl) {
+        // true == x is x, false == x is Not(x)
+        if (cl->getWidth() == Bool)
+            return cl->isTrue() ? r : NotExpr::create(r);
+        // c == c2 + x is (c - c2) == x
+        if (isa<AddExpr>(r.get()) && getConstantLeft(r))
+            return EqExpr::create(SubExpr::create(l, r->getKid(0)), r->getKid(1));
+        // c == c2 - x is (c2 - c) == x
+        if (isa<SubExpr>(r.get()) && getConstantLeft(r))
+            return EqExpr::create(SubExpr::create(r->getKid(0), l), r->getKid(1));
     }
-    
+
     return EqExpr::alloc(l, r);
 }
 
+ref<Expr> NeExpr::create(const ref<Expr> l, const ref<Expr> r) {
+    return NotExpr::create(EqExpr::create(l, r));
+}
+
+ref<Expr> UltExpr::create(const ref<Expr> l, const ref<Expr> r) {
+    ConstantExpr *cl = getConstant(l);
+    ConstantExpr *cr = getConstant(r);
+
+    if (cl && cr)
+        return fold(Ult, cl, cr);
+    if (l.get() == r.get())
+        return ConstantExpr::alloc(0, Bool);
+
+    return UltExpr::alloc(l, r);
+}
+
+ref<Expr> UleExpr::create(const ref<Expr> l, const ref<Expr> r) {
+    ConstantExpr *cl = getConstant(l);
+    ConstantExpr *cr = getConstant(r);
+
+    if (cl && cr)
+        return fold(Ule, cl, cr);
+    if (l.get() == r.get())
+        return ConstantExpr::alloc(1, Bool);
+
+    return UleExpr::alloc(l, r);
+}
+
+ref<Expr> UgtExpr::create(const ref<Expr> l, const ref<Expr> r) {
+    return UltExpr::create(r, l);
+}
+
+ref<Expr> UgeExpr::create(const ref<Expr> l, const ref<Expr> r) {
+    return UleExpr::create(r, l);
+}
+
+ref<Expr> SltExpr::create(const ref<Expr> l, const ref<Expr> r) {
+    ConstantExpr *cl = getConstant(l);
+    ConstantExpr *cr = getConstant(r);
+
+    if (cl && cr)
+        return fold(Slt, cl, cr);
+    if (l.get() == r.get())
+        return ConstantExpr::alloc(0, Bool);
+
+    return SltExpr::alloc(l, r);
+}
+
+ref<Expr> SleExpr::create(const ref<Expr> l, const ref<Expr> r) {
+    ConstantExpr *cl = getConstant(l);
+    ConstantExpr *cr = getConstant(r);
+
+    if (cl && cr)
+        return fold(Sle, cl, cr);
+    if (l.get() == r.get())
+        return ConstantExpr::alloc(1, Bool);
+
+    return SleExpr::alloc(l, r);
+}
+
+ref<Expr> SgtExpr::create(const ref<Expr> l, const ref<Expr> r) {
+    return SltExpr::create(r, l);
+}
+
+ref<Expr> SgeExpr::create(const ref<Expr> l, const ref<Expr> r) {
+    return SleExpr::create(r, l);
+}
+
 ref<Expr> Expr::createIsZero(ref<Expr> e) {
     return EqExpr::create(e, ConstantExpr::create(0, e->getWidth()));
 }
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include "ExprAllocator.h"
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+
+using namespace miniklee;
+
+namespace {
+struct FreeNode {
+    FreeNode *next;
+};
+
+/// Nodes moved from the shared pool to a thread in one go.
+const std::size_t RefillBatch = 64;
+
+std::size_t classOf(std::size_t size) {
+    return (size + ExprAllocator::Granularity - 1) / ExprAllocator::Granularity - 1;
+}
+
+std::size_t classSize(std::size_t c) {
+    return (c + 1) * ExprAllocator::Granularity;
+}
+
+struct ThreadCache {
+    FreeNode *free[ExprAllocator::NumClasses] = {};
+    /// Written by the owning thread only; atomic so getLiveBytes() can
+    /// read it from elsewhere. May go negative when a thread frees nodes
+    /// another one allocated.
+    std::atomic<std::int64_t> liveBytes{0};
+};
+
+struct SharedPool {
+    std::mutex lock;
+    FreeNode *free[ExprAllocator::NumClasses] = {};
+    std::vector<ThreadCache *> caches;
+};
+
+SharedPool &getPool() {
+    // Never destroyed: nodes may be freed during static destruction.
+    static SharedPool *pool = new SharedPool();
+    return *pool;
+}
+
+std::atomic<std::uint64_t> reservedBytes(0);
+/// Live bytes of large nodes, of exited threads and of allocations made
+/// while a thread is exiting.
+std::atomic<std::int64_t> sharedLiveBytes(0);
+
+/// Split a fresh slab into nodes of class \p c. Call with the pool locked.
+FreeNode *carveSlab(std::size_t c) {
+    std::size_t size = classSize(c);
+    char *slab = static_cast<char *>(::operator new(ExprAllocator::SlabSize));
+    reservedBytes.fetch_add(ExprAllocator::SlabSize, std::memory_order_relaxed);
+
+    FreeNode *head = nullptr;
+    // Link from the top down, so the list hands out ascending addresses.
+    for (std::size_t off = (ExprAllocator::SlabSize / size) * size; off >= size;) {
+        off -= size;
+        FreeNode *n = reinterpret_cast<FreeNode *>(slab + off);
+        n->next = head;
+        head = n;
+    }
+    return head;
+}
+
+/// Take up to RefillBatch nodes of class \p c. Call with the pool locked.
+FreeNode *takeFromPool(SharedPool &pool, std::size_t c) {
+    if (!pool.free[c])
+        return carveSlab(c);
+
+    FreeNode *head = pool.free[c];
+    FreeNode *tail = head;
+    for (std::size_t i = 1; i < RefillBatch && tail->next; ++i)
+        tail = tail->next;
+    pool.free[c] = tail->next;
+    tail->next = nullptr;
+    return head;
+}
+
+void retire(ThreadCache *cache) {
+    SharedPool &pool = getPool();
+    std::lock_guard<std::mutex> guard(pool.lock);
+    for (std::size_t c = 0; c < ExprAllocator::NumClasses; ++c) {
+        while (FreeNode *n = cache->free[c]) {
+            cache->free[c] = n->next;
+            n->next = pool.free[c];
+            pool.free[c] = n;
+        }
+    }
+    sharedLiveBytes.fetch_add(cache->liveBytes.load(std::memory_order_relaxed),
+                              std::memory_order_relaxed);
+    for (auto it = pool.caches.begin(); it != pool.caches.end(); ++it) {
+        if (*it == cache) {
+            pool.caches.erase(it);
+            break;
+        }
+    }
+    delete cache;
+}
+
+thread_local ThreadCache *localCache = nullptr;
+thread_local bool localRetired = false;
+
+struct CacheGuard {
+    ~CacheGuard() {
+        if (localCache)
+            retire(localCache);
+        localCache = nullptr;
+        localRetired = true;
+    }
+};
+
+/// The calling thread's cache, or null once the thread is exiting.
+ThreadCache *getCache() {
+    if (localCache)
+        return localCache;
+    if (localRetired)
+        return nullptr;
+
+    thread_local CacheGuard guard;
+    (void) guard;
+
+    localCache = new ThreadCache();
+    SharedPool &pool = getPool();
+    std::lock_guard<std::mutex> lock(pool.lock);
+    pool.caches.push_back(localCache);
+    return localCache;
+}
+
+void addLive(ThreadCache *cache, std::int64_t delta) {
+    // Single writer: a plain load/store pair avoids a locked instruction.
+    cache->liveBytes.store(cache->liveBytes.load(std::memory_order_relaxed) + delta,
+                           std::memory_order_relaxed);
+}
+} // namespace
+
+void *ExprAllocator::allocate(std::size_t size) {
+    if (size > MaxSize) {
+        reservedBytes.fetch_add(size, std::memory_order_relaxed);
+        sharedLiveBytes.fetch_add(size, std::memory_order_relaxed);
+        return ::operator new(size);
+    }
+
+    std::size_t c = classOf(size);
+    ThreadCache *cache = getCache();
+    if (!cache) {
+        SharedPool &pool = getPool();
+        std::lock_guard<std::mutex> guard(pool.lock);
+        FreeNode *n = pool.free[c] ? pool.free[c] : carveSlab(c);
+        pool.free[c] = n->next;
+        sharedLiveBytes.fetch_add(classSize(c), std::memory_order_relaxed);
+        return n;
+    }
+
+    FreeNode *n = cache->free[c];
+    if (!n) {
+        SharedPool &pool = getPool();
+        std::lock_guard<std::mutex> guard(pool.lock);
+        n = takeFromPool(pool, c);
+    }
+    cache->free[c] = n->next;
+    addLive(cache, classSize(c));
+    return n;
+}
+
+void ExprAllocator::deallocate(void *p, std::size_t size) {
+    if (!p)
+        return;
+
+    if (size > MaxSize) {
+        ::operator delete(p);
+        reservedBytes.fetch_sub(size, std::memory_order_relaxed);
+        sharedLiveBytes.fetch_sub(size, std::memory_order_relaxed);
+        return;
+    }
+
+    std::size_t c = classOf(size);
+    FreeNode *n = static_cast<FreeNode *>(p);
+    ThreadCache *cache = getCache();
+    if (!cache) {
+        SharedPool &pool = getPool();
+        std::lock_guard<std::mutex> guard(pool.lock);
+        n->next = pool.free[c];
+        pool.free[c] = n;
+        sharedLiveBytes.fetch_sub(classSize(c), std::memory_order_relaxed);
+        return;
+    }
+
+    n->next = cache->free[c];
+    cache->free[c] = n;
+    addLive(cache, -static_cast<std::int64_t>(classSize(c)));
+}
+
+std::uint64_t ExprAllocator::getLiveBytes() {
+    SharedPool &pool = getPool();
+    std::lock_guard<std::mutex> guard(pool.lock);
+    std::int64_t total = sharedLiveBytes.load(std::memory_order_relaxed);
+    for (ThreadCache *cache : pool.caches)
+        total += cache->liveBytes.load(std::memory_order_relaxed);
+    return total > 0 ? total : 0;
+}
+
+std::uint64_t ExprAllocator::getReservedBytes() {
+    return reservedBytes.load(std::memory_order_relaxed);
+}
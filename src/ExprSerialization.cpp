@@ -0,0 +1,270 @@
+#include "ExprSerialization.h"
+
+#include "Constraints.h"
+#include "Solver.h"
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/LEB128.h"
+
+#include <utility>
+
+using namespace miniklee;
+using namespace miniklee::serialization;
+
+namespace {
+std::uint8_t getNodeTag(Expr::Kind k) {
+    return NodeTagBase + (k - Expr::InvalidKind);
+}
+
+/// Largest constant width accepted when reading.
+const std::uint64_t MaxWidth = 1u << 16;
+} // namespace
+
+ExprWriter::ExprWriter(llvm::raw_ostream &os) : os(os) {
+    os.write(Magic, sizeof(Magic));
+    llvm::encodeULEB128(Version, os);
+}
+
+std::uint64_t ExprWriter::writeNode(const ref<Expr> &root) {
+    // Post order with an explicit stack, so kids get their ids first.
+    std::vector<std::pair<ref<Expr>, bool>> stack;
+    stack.emplace_back(root, false);
+    while (!stack.empty()) {
+        const Expr *e = stack.back().first.get();
+        if (ids.count(e)) {
+            stack.pop_back();
+            continue;
+        }
+        if (!stack.back().second) {
+            stack.back().second = true;
+            for (unsigned i = 0; i < e->getNumKids(); ++i)
+                stack.emplace_back(e->getKid(i), false);
+            continue;
+        }
+
+        std::uint64_t id = written.size();
+        os << static_cast<char>(getNodeTag(e->getKind()));
+        switch (e->getKind()) {
+        case Expr::Constant:
+        case Expr::InvalidKind: {
+            llvm::APInt v = e->getKind() == Expr::Constant
+                                ? cast<ConstantExpr>(e)->getAPValue()
+                                : cast<InvalidKindExpr>(e)->getAPValue();
+            llvm::encodeULEB128(v.getBitWidth(), os);
+            for (unsigned i = 0; i < v.getNumWords(); ++i)
+                llvm::encodeULEB128(v.getRawData()[i], os);
+            break;
+        }
+        case Expr::Symbolic: {
+            const Symbol *symbol = cast<SymbolicExpr>(e)->getSymbol();
+            llvm::encodeULEB128(symbol->name.size(), os);
+            os << symbol->name;
+            llvm::encodeULEB128(symbol->width, os);
+            llvm::encodeULEB128(symbol->size, os);
+            break;
+        }
+        default:
+            for (unsigned i = 0; i < e->getNumKids(); ++i)
+                llvm::encodeULEB128(id - ids[e->getKid(i).get()], os);
+        }
+
+        ids[e] = id;
+        written.push_back(std::move(stack.back().first));
+        stack.pop_back();
+    }
+    return ids[root.get()];
+}
+
+void ExprWriter::write(const ref<Expr> &e) {
+    std::uint64_t id = writeNode(e);
+    os << static_cast<char>(ExprTag);
+    llvm::encodeULEB128(id, os);
+}
+
+void ExprWriter::write(const Query &query) {
+    std::vector<ref<Expr>> constraints = query.constraints.toVector();
+
+    std::vector<std::uint64_t> roots;
+    for (const ref<Expr> &c : constraints)
+        roots.push_back(writeNode(c));
+    roots.push_back(writeNode(query.expr));
+
+    os << static_cast<char>(QueryTag);
+    llvm::encodeULEB128(constraints.size(), os);
+    for (std::uint64_t id : roots)
+        llvm::encodeULEB128(id, os);
+}
+
+ExprReader::ExprReader(llvm::StringRef buffer)
+    : pos(reinterpret_cast<const std::uint8_t *>(buffer.begin())),
+      end(reinterpret_cast<const std::uint8_t *>(buffer.end())) {
+    if (buffer.size() < sizeof(Magic) || !buffer.startswith(llvm::StringRef(Magic, sizeof(Magic)))) {
+        fail("not an expression stream");
+        return;
+    }
+    pos += sizeof(Magic);
+
+    std::uint64_t version;
+    if (readULEB(version) && version != Version)
+        fail("unsupported version " + std::to_string(version));
+}
+
+bool ExprReader::fail(const std::string &message) {
+    if (error.empty())
+        error = message;
+    pos = end;
+    return false;
+}
+
+bool ExprReader::readULEB(std::uint64_t &value) {
+    unsigned n;
+    const char *err = nullptr;
+    value = llvm::decodeULEB128(pos, &n, end, &err);
+    if (err)
+        return fail(err);
+    pos += n;
+    return true;
+}
+
+bool ExprReader::readId(std::uint64_t &id) {
+    if (!readULEB(id))
+        return false;
+    if (id >= nodes.size())
+        return fail("reference to undefined node " + std::to_string(id));
+    return true;
+}
+
+bool ExprReader::readKid(ref<Expr> &kid) {
+    std::uint64_t distance;
+    if (!readULEB(distance))
+        return false;
+    if (distance == 0 || distance > nodes.size())
+        return fail("invalid kid reference");
+    kid = nodes[nodes.size() - distance];
+    return true;
+}
+
+bool ExprReader::readNode(std::uint8_t tag) {
+    int k = static_cast<int>(tag - NodeTagBase) + Expr::InvalidKind;
+    if (k > Expr::LastKind)
+        return fail("invalid node tag " + std::to_string(tag));
+    Expr::Kind kind = static_cast<Expr::Kind>(k);
+
+    ref<Expr> node;
+    switch (kind) {
+    case Expr::Constant:
+    case Expr::InvalidKind: {
+        std::uint64_t width;
+        if (!readULEB(width))
+            return false;
+        if (width == 0 || width > MaxWidth)
+            return fail("invalid constant width");
+        llvm::SmallVector<std::uint64_t, 1> words((width + 63) / 64);
+        for (std::uint64_t &w : words)
+            if (!readULEB(w))
+                return false;
+        llvm::APInt value(width, words);
+        if (kind == Expr::Constant)
+            node = ConstantExpr::alloc(value);
+        else
+            node = InvalidKindExpr::alloc(value);
+        break;
+    }
+    case Expr::Symbolic: {
+        std::uint64_t length;
+        if (!readULEB(length))
+            return false;
+        if (length > static_cast<std::uint64_t>(end - pos))
+            return fail("truncated symbol name");
+        std::string name(reinterpret_cast<const char *>(pos), length);
+        pos += length;
+        std::uint64_t width, size;
+        if (!readULEB(width) || !readULEB(size))
+            return false;
+        if (width == 0 || width > MaxWidth || size == 0 || size > UINT32_MAX)
+            return fail("invalid symbol shape");
+        const Symbol *symbol = SymbolTable::find(name);
+        if (symbol && (symbol->width != width || symbol->size != size))
+            return fail("symbol redeclared with a different shape");
+        node = SymbolicExpr::alloc(symbol ? symbol : SymbolTable::get(name, width, size));
+        break;
+    }
+    case Expr::Not: {
+        ref<Expr> kid;
+        if (!readKid(kid))
+            return false;
+        node = NotExpr::alloc(kid);
+        break;
+    }
+    default: {
+        ref<Expr> l, r;
+        if (!readKid(l) || !readKid(r))
+            return false;
+        if (l->getWidth() != r->getWidth())
+            return fail("operand widths differ");
+
+        switch (kind) {
+#define X(C) case Expr::C: node = C##Expr::alloc(l, r); break
+        X(Add);
+        X(Sub);
+        X(Mul);
+        X(UDiv);
+        X(SDiv);
+        X(Eq);
+        X(Ne);
+        X(Ult);
+        X(Ule);
+        X(Ugt);
+        X(Uge);
+        X(Slt);
+        X(Sle);
+        X(Sgt);
+        X(Sge);
+#undef X
+        default:
+            return fail("invalid node kind");
+        }
+    }
+    }
+
+    nodes.push_back(std::move(node));
+    return true;
+}
+
+bool ExprReader::next(Record &record) {
+    while (pos != end) {
+        std::uint8_t tag = *pos++;
+        if (tag >= NodeTagBase) {
+            if (!readNode(tag))
+                return false;
+            continue;
+        }
+
+        std::uint64_t id, count = 0;
+        if (tag == QueryTag) {
+            if (!readULEB(count))
+                return false;
+            // Every id takes at least one byte.
+            if (count >= static_cast<std::uint64_t>(end - pos))
+                return fail("truncated query");
+        }
+
+        record.kind = tag == QueryTag ? Record::QueryRecord : Record::ExprRecord;
+        record.exprs.clear();
+        for (std::uint64_t i = 0; i <= count; ++i) {
+            if (!readId(id))
+                return false;
+            record.exprs.push_back(nodes[id]);
+        }
+        return true;
+    }
+    return false;
+}
+
+ConstraintSet ExprReader::getConstraints(const Record &record) {
+    assert(record.kind == Record::QueryRecord && "Not a query record");
+    ConstraintSet constraints;
+    for (std::size_t i = 0; i + 1 < record.exprs.size(); ++i)
+        constraints.push_back(record.exprs[i]);
+    return constraints;
+}
@@ -0,0 +1,630 @@
+#include "Solver.h"
+
+#include "BatchEvaluator.h"
+#include "Constraints.h"
+#include "SolverImpl.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace miniklee {
+
+namespace {
+
+/// The values an expression of at most 32 bits may take, as a signed and
+/// an unsigned interval. Both over-approximate, so either one being empty
+/// means there is no value; normalize() tightens each from the other.
+struct ValueRange {
+    std::int64_t smin, smax;
+    std::int64_t umin, umax;
+
+    static std::int64_t signedMin(Expr::Width w) { return -(std::int64_t(1) << (w - 1)); }
+    static std::int64_t signedMax(Expr::Width w) { return (std::int64_t(1) << (w - 1)) - 1; }
+    static std::int64_t unsignedMax(Expr::Width w) { return (std::int64_t(1) << w) - 1; }
+
+    static ValueRange full(Expr::Width w) {
+        return ValueRange{signedMin(w), signedMax(w), 0, unsignedMax(w)};
+    }
+
+    static ValueRange point(std::uint64_t value, Expr::Width w) {
+        std::int64_t u = static_cast<std::int64_t>(value & unsignedMax(w));
+        std::int64_t s = u > signedMax(w) ? u - (std::int64_t(1) << w) : u;
+        return ValueRange{s, s, u, u};
+    }
+
+    bool isEmpty() const { return smin > smax || umin > umax; }
+    bool isPoint() const { return umin == umax; }
+
+    bool operator==(const ValueRange &r) const {
+        return smin == r.smin && smax == r.smax && umin == r.umin && umax == r.umax;
+    }
+
+    void normalize(Expr::Width w) {
+        if (isEmpty())
+            return;
+        std::int64_t modulus = std::int64_t(1) << w;
+        // A signed interval on one side of zero maps to an unsigned one.
+        if (smin >= 0) {
+            umin = std::max(umin, smin);
+            umax = std::min(umax, smax);
+        } else if (smax < 0) {
+            umin = std::max(umin, smin + modulus);
+            umax = std::min(umax, smax + modulus);
+        }
+        if (isEmpty())
+            return;
+        if (umax <= signedMax(w)) {
+            smin = std::max(smin, umin);
+            smax = std::min(smax, umax);
+        } else if (umin > signedMax(w)) {
+            smin = std::max(smin, umin - modulus);
+            smax = std::min(smax, umax - modulus);
+        }
+    }
+
+    ValueRange &intersect(const ValueRange &r, Expr::Width w) {
+        smin = std::max(smin, r.smin);
+        smax = std::min(smax, r.smax);
+        umin = std::max(umin, r.umin);
+        umax = std::min(umax, r.umax);
+        normalize(w);
+        return *this;
+    }
+};
+
+/// Bitwise negation, which is logical negation for Bool.
+ValueRange bitNot(const ValueRange &r, Expr::Width w) {
+    ValueRange res{-r.smax - 1, -r.smin - 1,
+                   ValueRange::unsignedMax(w) - r.umax, ValueRange::unsignedMax(w) - r.umin};
+    return res;
+}
+
+bool fitsSigned(std::int64_t lo, std::int64_t hi, Expr::Width w) {
+    return lo >= ValueRange::signedMin(w) && hi <= ValueRange::signedMax(w);
+}
+
+ValueRange add(const ValueRange &a, const ValueRange &b, Expr::Width w) {
+    ValueRange res = ValueRange::full(w);
+    if (fitsSigned(a.smin + b.smin, a.smax + b.smax, w)) {
+        res.smin = a.smin + b.smin;
+        res.smax = a.smax + b.smax;
+    }
+    if (a.umax + b.umax <= ValueRange::unsignedMax(w)) {
+        res.umin = a.umin + b.umin;
+        res.umax = a.umax + b.umax;
+    }
+    res.normalize(w);
+    return res;
+}
+
+ValueRange sub(const ValueRange &a, const ValueRange &b, Expr::Width w) {
+    ValueRange res = ValueRange::full(w);
+    if (fitsSigned(a.smin - b.smax, a.smax - b.smin, w)) {
+        res.smin = a.smin - b.smax;
+        res.smax = a.smax - b.smin;
+    }
+    if (a.umin >= b.umax) {
+        res.umin = a.umin - b.umax;
+        res.umax = a.umax - b.umin;
+    }
+    res.normalize(w);
+    return res;
+}
+
+ValueRange mul(const ValueRange &a, const ValueRange &b, Expr::Width w) {
+    ValueRange res = ValueRange::full(w);
+    // Signed corner products of 32-bit operands fit in 64 bits.
+    std::int64_t corners[] = {a.smin * b.smin, a.smin * b.smax, a.smax * b.smin,
+                              a.smax * b.smax};
+    std::int64_t lo = *std::min_element(corners, corners + 4);
+    std::int64_t hi = *std::max_element(corners, corners + 4);
+    if (fitsSigned(lo, hi, w)) {
+        res.smin = lo;
+        res.smax = hi;
+    }
+    // Unsigned products of 32-bit operands only fit in 64 bits unsigned.
+    if (std::uint64_t(a.umax) * std::uint64_t(b.umax) <=
+        std::uint64_t(ValueRange::unsignedMax(w))) {
+        res.umin = a.umin * b.umin;
+        res.umax = a.umax * b.umax;
+    }
+    res.normalize(w);
+    return res;
+}
+
+/// Express comparison \p k as \p base, one of Eq, Ult, Ule, Slt and Sle,
+/// applied to the operands swapped if \p swap and negated if \p negate.
+/// Returns false if \p k is not a comparison.
+bool getCanonicalCompare(Expr::Kind k, Expr::Kind &base, bool &swap, bool &negate) {
+    swap = negate = false;
+    switch (k) {
+    case Expr::Eq:
+    case Expr::Ult:
+    case Expr::Ule:
+    case Expr::Slt:
+    case Expr::Sle:
+        base = k;
+        return true;
+    case Expr::Ne:  base = Expr::Eq; negate = true; return true;
+    case Expr::Ugt: base = Expr::Ult; swap = true; return true;
+    case Expr::Uge: base = Expr::Ule; swap = true; return true;
+    case Expr::Sgt: base = Expr::Slt; swap = true; return true;
+    case Expr::Sge: base = Expr::Sle; swap = true; return true;
+    default:
+        return false;
+    }
+}
+
+/// Whether \p base holds for all (1), none (0) or some (-1) of the values
+/// in \p a and \p b.
+int compare(Expr::Kind base, const ValueRange &a, const ValueRange &b) {
+    switch (base) {
+    case Expr::Eq:
+        if (a.isPoint() && b.isPoint() && a.umin == b.umin)
+            return 1;
+        if (a.umax < b.umin || b.umax < a.umin || a.smax < b.smin || b.smax < a.smin)
+            return 0;
+        return -1;
+    case Expr::Ult:
+        return a.umax < b.umin ? 1 : a.umin >= b.umax ? 0 : -1;
+    case Expr::Ule:
+        return a.umax <= b.umin ? 1 : a.umin > b.umax ? 0 : -1;
+    case Expr::Slt:
+        return a.smax < b.smin ? 1 : a.smin >= b.smax ? 0 : -1;
+    case Expr::Sle:
+        return a.smax <= b.smin ? 1 : a.smin > b.smax ? 0 : -1;
+    default:
+        return -1;
+    }
+}
+
+/// Narrow \p ra and \p rb, initially full, to the values of \p a and \p b
+/// that can make \p base come out as \p holds.
+void requireCompare(Expr::Kind base, bool holds, const ValueRange &a,
+                    const ValueRange &b, Expr::Width w, ValueRange &ra, ValueRange &rb) {
+    switch (base) {
+    case Expr::Eq:
+        if (holds) {
+            ra = b;
+            rb = a;
+            break;
+        }
+        // Only an excluded endpoint can be cut off an interval.
+        if (b.isPoint()) {
+            ra = a;
+            if (ra.smin == b.smin) ++ra.smin;
+            if (ra.smax == b.smin) --ra.smax;
+            if (ra.umin == b.umin) ++ra.umin;
+            if (ra.umax == b.umin) --ra.umax;
+        }
+        if (a.isPoint()) {
+            rb = b;
+            if (rb.smin == a.smin) ++rb.smin;
+            if (rb.smax == a.smin) --rb.smax;
+            if (rb.umin == a.umin) ++rb.umin;
+            if (rb.umax == a.umin) --rb.umax;
+        }
+        break;
+    case Expr::Ult:
+        if (holds) {
+            ra.umax = b.umax - 1;
+            rb.umin = a.umin + 1;
+        } else {
+            ra.umin = b.umin;
+            rb.umax = a.umax;
+        }
+        break;
+    case Expr::Ule:
+        if (holds) {
+            ra.umax = b.umax;
+            rb.umin = a.umin;
+        } else {
+            ra.umin = b.umin + 1;
+            rb.umax = a.umax - 1;
+        }
+        break;
+    case Expr::Slt:
+        if (holds) {
+            ra.smax = b.smax - 1;
+            rb.smin = a.smin + 1;
+        } else {
+            ra.smin = b.smin;
+            rb.smax = a.smax;
+        }
+        break;
+    case Expr::Sle:
+        if (holds) {
+            ra.smax = b.smax;
+            rb.smin = a.smin;
+        } else {
+            ra.smin = b.smin + 1;
+            rb.smax = a.smax - 1;
+        }
+        break;
+    default:
+        break;
+    }
+    ra.normalize(w);
+    rb.normalize(w);
+}
+
+/// Kinds BatchEvaluator can check candidates against.
+bool isSupported(const Expr &e) {
+    if (e.getWidth() > Expr::Int32)
+        return false;
+    switch (e.getKind()) {
+    case Expr::Constant:
+        return !cast<ConstantExpr>(&e)->isWide();
+    case Expr::Symbolic:
+    case Expr::Not:
+    case Expr::Add:
+    case Expr::Sub:
+    case Expr::Mul:
+    case Expr::UDiv:
+    case Expr::SDiv:
+        return true;
+    default:
+        Expr::Kind base;
+        bool swap, negate;
+        return getCanonicalCompare(e.getKind(), base, swap, negate);
+    }
+}
+
+/// Decides whether a conjunction of Bool expressions is satisfiable by
+/// interval reasoning: ranges of the symbols are narrowed by propagating
+/// each expression's required truth down to its leaves, then the ends and
+/// middle of the final ranges are tried as a counterexample.
+class RangeAnalysis {
+public:
+    enum Outcome { Unsatisfiable, Satisfiable, Unknown };
+
+    explicit RangeAnalysis(const std::vector<ref<Expr>> &exprs) : exprs(exprs) {}
+
+    Outcome run();
+
+    /// The satisfying assignment found by run(), sorted by symbol id.
+    const std::vector<std::pair<const Symbol *, std::int32_t>> &getModel() const {
+        return model;
+    }
+
+private:
+    /// Rounds of propagation before giving up on a fixpoint.
+    static const unsigned MaxRounds = 8;
+    /// Ranges required of subexpressions per round, per expression node.
+    static const std::size_t MaxStepsPerNode = 4;
+
+    const std::vector<ref<Expr>> &exprs;
+    std::unordered_map<const Symbol *, ValueRange> symbols;
+    /// Range of every node, for the current symbol ranges.
+    std::unordered_map<const Expr *, ValueRange> ranges;
+    bool changed = false;
+    std::vector<std::pair<const Symbol *, std::int32_t>> model;
+
+    ValueRange getSymbolRange(const Symbol *s) {
+        return symbols.emplace(s, ValueRange::full(s->width)).first->second;
+    }
+
+    /// Fill in the range of every node under \p root. Returns false if it
+    /// holds anything the analysis does not support.
+    bool evaluate(const ref<Expr> &root);
+    ValueRange evaluateNode(const Expr &e);
+    /// Narrow the ranges under \p root to the values that make it true.
+    /// Returns false if there are none.
+    bool propagate(const ref<Expr> &root);
+    bool tryCandidates();
+};
+
+RangeAnalysis::Outcome RangeAnalysis::run() {
+    for (unsigned round = 0; round < MaxRounds; ++round) {
+        ranges.clear();
+        changed = false;
+        for (const ref<Expr> &e : exprs)
+            if (!evaluate(e))
+                return Unknown;
+        for (const ref<Expr> &e : exprs)
+            if (!propagate(e))
+                return Unsatisfiable;
+        if (!changed)
+            break;
+    }
+    return tryCandidates() ? Satisfiable : Unknown;
+}
+
+bool RangeAnalysis::evaluate(const ref<Expr> &root) {
+    // Explicit stack: path conditions can be deeper than the call stack.
+    std::vector<std::pair<const Expr *, bool>> stack;
+    stack.emplace_back(root.get(), false);
+    while (!stack.empty()) {
+        const Expr *e = stack.back().first;
+        if (ranges.count(e)) {
+            stack.pop_back();
+            continue;
+        }
+        if (!stack.back().second) {
+            if (!isSupported(*e))
+                return false;
+            stack.back().second = true;
+            for (unsigned i = 0; i < e->getNumKids(); ++i)
+                stack.emplace_back(e->getKid(i).get(), false);
+            continue;
+        }
+        stack.pop_back();
+        ranges.emplace(e, evaluateNode(*e));
+    }
+    return true;
+}
+
+ValueRange RangeAnalysis::evaluateNode(const Expr &e) {
+    Expr::Width w = e.getWidth();
+    auto kid = [&](unsigned i) { return ranges.at(e.getKid(i).get()); };
+    switch (e.getKind()) {
+    case Expr::Constant:
+        return ValueRange::point(cast<ConstantExpr>(&e)->getZExtValue(), w);
+    case Expr::Symbolic:
+        return getSymbolRange(cast<SymbolicExpr>(&e)->getSymbol());
+    case Expr::Not:
+        return bitNot(kid(0), w);
+    case Expr::Add:
+        return add(kid(0), kid(1), w);
+    case Expr::Sub:
+        return sub(kid(0), kid(1), w);
+    case Expr::Mul:
+        return mul(kid(0), kid(1), w);
+    default: {
+        Expr::Kind base;
+        bool swap, negate;
+        if (!getCanonicalCompare(e.getKind(), base, swap, negate))
+            return ValueRange::full(w);
+        int holds = swap ? compare(base, kid(1), kid(0)) : compare(base, kid(0), kid(1));
+        if (holds < 0)
+            return ValueRange::full(w);
+        return ValueRange::point(holds != negate, w);
+    }
+    }
+}
+
+bool RangeAnalysis::propagate(const ref<Expr> &root) {
+    std::vector<std::pair<const Expr *, ValueRange>> work;
+    work.emplace_back(root.get(), ValueRange::point(1, Expr::Bool));
+    std::size_t budget = MaxStepsPerNode * ranges.size();
+    while (!work.empty() && budget-- > 0) {
+        const Expr *e = work.back().first;
+        ValueRange required = work.back().second;
+        work.pop_back();
+
+        Expr::Width w = e->getWidth();
+        ValueRange &current = ranges.at(e);
+        ValueRange narrowed = current;
+        narrowed.intersect(required, w);
+        if (narrowed.isEmpty())
+            return false;
+        if (narrowed == current)
+            continue;
+        current = narrowed;
+
+        switch (e->getKind()) {
+        case Expr::Symbolic: {
+            ValueRange &r = symbols.at(cast<SymbolicExpr>(e)->getSymbol());
+            r = narrowed;
+            changed = true;
+            break;
+        }
+        case Expr::Not:
+            work.emplace_back(e->getKid(0).get(), bitNot(narrowed, w));
+            break;
+        case Expr::Add:
+        case Expr::Sub: {
+            // Without wrap-around, r = a + b gives a = r - b and b = r - a;
+            // r = a - b gives a = r + b and b = a - r. Each view of a and
+            // b is only narrowed if that view cannot wrap.
+            const Expr *ea = e->getKid(0).get(), *eb = e->getKid(1).get();
+            const ValueRange &a = ranges.at(ea), &b = ranges.at(eb);
+            bool isAdd = e->getKind() == Expr::Add;
+            ValueRange ra = ValueRange::full(w), rb = ValueRange::full(w);
+            if (isAdd ? fitsSigned(a.smin + b.smin, a.smax + b.smax, w)
+                      : fitsSigned(a.smin - b.smax, a.smax - b.smin, w)) {
+                ra.smin = isAdd ? narrowed.smin - b.smax : narrowed.smin + b.smin;
+                ra.smax = isAdd ? narrowed.smax - b.smin : narrowed.smax + b.smax;
+                rb.smin = isAdd ? narrowed.smin - a.smax : a.smin - narrowed.smax;
+                rb.smax = isAdd ? narrowed.smax - a.smin : a.smax - narrowed.smin;
+            }
+            if (isAdd ? a.umax + b.umax <= ValueRange::unsignedMax(w) : a.umin >= b.umax) {
+                ra.umin = isAdd ? narrowed.umin - b.umax : narrowed.umin + b.umin;
+                ra.umax = isAdd ? narrowed.umax - b.umin : narrowed.umax + b.umax;
+                rb.umin = isAdd ? narrowed.umin - a.umax : a.umin - narrowed.umax;
+                rb.umax = isAdd ? narrowed.umax - a.umin : a.umax - narrowed.umin;
+            }
+            // Clamp to the width before normalizing.
+            ra.intersect(ValueRange::full(w), w);
+            rb.intersect(ValueRange::full(w), w);
+            work.emplace_back(ea, ra);
+            work.emplace_back(eb, rb);
+            break;
+        }
+        default: {
+            Expr::Kind base;
+            bool swap, negate;
+            if (!narrowed.isPoint() || !getCanonicalCompare(e->getKind(), base, swap, negate))
+                break;
+            const Expr *ea = e->getKid(swap ? 1 : 0).get();
+            const Expr *eb = e->getKid(swap ? 0 : 1).get();
+            Expr::Width kw = ea->getWidth();
+            ValueRange ra = ValueRange::full(kw), rb = ValueRange::full(kw);
+            requireCompare(base, (narrowed.umin == 1) != negate, ranges.at(ea),
+                           ranges.at(eb), kw, ra, rb);
+            work.emplace_back(ea, ra);
+            work.emplace_back(eb, rb);
+            break;
+        }
+        }
+    }
+    return true;
+}
+
+/// Check the ends, middle and value nearest zero of every symbol's range
+/// at once; each candidate takes the same choice for all symbols.
+bool RangeAnalysis::tryCandidates() {
+    const unsigned NumCandidates = 6;
+
+    BatchEvaluator evaluator(exprs);
+    const std::vector<const Symbol *> &inputs = evaluator.getSymbols();
+    std::vector<std::vector<std::int32_t>> columns(inputs.size());
+    std::vector<const std::int32_t *> columnPtrs(inputs.size());
+    for (std::size_t s = 0; s < inputs.size(); ++s) {
+        ValueRange r = getSymbolRange(inputs[s]);
+        std::int64_t values[NumCandidates] = {
+            r.smin, r.smax, r.smin + (r.smax - r.smin) / 2,
+            std::min(std::max(std::int64_t(0), r.smin), r.smax), r.umin, r.umax};
+        for (std::int64_t v : values)
+            columns[s].push_back(static_cast<std::int32_t>(v));
+        columnPtrs[s] = columns[s].data();
+    }
+
+    std::uint8_t satisfied[NumCandidates];
+    if (evaluator.filter(columnPtrs.data(), NumCandidates, satisfied) == 0)
+        return false;
+
+    std::size_t lane = std::find(satisfied, satisfied + NumCandidates, 1) - satisfied;
+    for (std::size_t s = 0; s < inputs.size(); ++s)
+        model.emplace_back(inputs[s], columns[s][lane]);
+    std::sort(model.begin(), model.end(),
+              [](const std::pair<const Symbol *, std::int32_t> &a,
+                 const std::pair<const Symbol *, std::int32_t> &b) {
+                  return a.first->id < b.first->id;
+              });
+    return true;
+}
+
+} // namespace
+
+/// Settles queries that interval reasoning can decide, and forwards the
+/// rest. Symbol ranges are narrowed by propagating signed and unsigned
+/// intervals through Add, Sub, Not and the comparisons, which proves the
+/// query unsatisfiable when some range runs empty; otherwise the ends and
+/// middle of the ranges are tried as a counterexample.
+class FastCexSolver : public SolverImpl {
+public:
+    explicit FastCexSolver(std::unique_ptr<Solver> solver)
+        : solver(std::move(solver)) {}
+    ~FastCexSolver();
+
+    bool computeValidity(const Query &, Solver::Validity &result);
+    bool computeTruth(const Query &, bool &isValid);
+    bool computeValue(const Query &query, ref<Expr> &result) {
+        return solver->impl->computeValue(query, result);
+    }
+    bool computeInitialValues(const Query &query,
+                              const std::vector<const SymbolicExpr *> &objects,
+                              std::vector<std::vector<int32_t> > &values,
+                              bool &hasSolution);
+    SolverRunStatus getOperationStatusCode() {
+        return solver->impl->getOperationStatusCode();
+    }
+    std::string getConstraintLog(const Query &query) {
+        return solver->impl->getConstraintLog(query);
+    }
+    void setCoreSolverTimeout(time::Span timeout) {
+        solver->impl->setCoreSolverTimeout(timeout);
+    }
+
+private:
+    std::unique_ptr<Solver> solver;
+
+    std::uint64_t queries = 0, answered = 0;
+
+    /// Run the analysis over the constraints of \p query and \p expr.
+    RangeAnalysis::Outcome analyze(const Query &query, const ref<Expr> &expr,
+                                   std::vector<std::pair<const Symbol *, std::int32_t>> *model);
+};
+
+FastCexSolver::~FastCexSolver() {
+    MINIKLEE_TRACE(Solver, Info,
+                   "Fast counterexample: {} of {} queries ({}%) decided by range analysis",
+                   answered, queries, queries ? answered * 100 / queries : 0);
+}
+
+RangeAnalysis::Outcome
+FastCexSolver::analyze(const Query &query, const ref<Expr> &expr,
+                       std::vector<std::pair<const Symbol *, std::int32_t>> *model) {
+    // Oldest first: a path tends to narrow a value a step per branch, and
+    // propagating in that order settles it in one round.
+    std::vector<ref<Expr>> exprs = query.constraints.toVector();
+    exprs.push_back(expr);
+    RangeAnalysis analysis(exprs);
+    RangeAnalysis::Outcome outcome = analysis.run();
+    ++queries;
+    if (outcome != RangeAnalysis::Unknown)
+        ++answered;
+    if (model && outcome == RangeAnalysis::Satisfiable)
+        *model = analysis.getModel();
+    return outcome;
+}
+
+bool FastCexSolver::computeValidity(const Query &query, Solver::Validity &result) {
+    RangeAnalysis::Outcome whenTrue = analyze(query, query.expr, nullptr);
+    RangeAnalysis::Outcome whenFalse =
+        analyze(query, Expr::createIsZero(query.expr), nullptr);
+    // Neither side satisfiable means the constraints are not: leave that
+    // to the underlying solver too.
+    if (whenTrue == RangeAnalysis::Unknown || whenFalse == RangeAnalysis::Unknown ||
+        (whenTrue == RangeAnalysis::Unsatisfiable &&
+         whenFalse == RangeAnalysis::Unsatisfiable))
+        return solver->impl->computeValidity(query, result);
+
+    if (whenTrue == RangeAnalysis::Unsatisfiable)
+        result = Solver::False;
+    else if (whenFalse == RangeAnalysis::Unsatisfiable)
+        result = Solver::True;
+    else
+        result = Solver::Unknown;
+    return true;
+}
+
+bool FastCexSolver::computeTruth(const Query &query, bool &isValid) {
+    // The query is valid iff its negation is unsatisfiable.
+    switch (analyze(query, Expr::createIsZero(query.expr), nullptr)) {
+    case RangeAnalysis::Satisfiable:
+        isValid = false;
+        return true;
+    case RangeAnalysis::Unsatisfiable:
+        isValid = true;
+        return true;
+    default:
+        return solver->impl->computeTruth(query, isValid);
+    }
+}
+
+bool FastCexSolver::computeInitialValues(
+    const Query &query, const std::vector<const SymbolicExpr *> &objects,
+    std::vector<std::vector<int32_t> > &values, bool &hasSolution) {
+    std::vector<std::pair<const Symbol *, std::int32_t>> model;
+    switch (analyze(query, query.expr, &model)) {
+    case RangeAnalysis::Unsatisfiable:
+        hasSolution = false;
+        return true;
+    case RangeAnalysis::Satisfiable:
+        for (std::size_t o = 0; o < objects.size(); ++o) {
+            // Objects the query does not read can take any value.
+            std::int32_t value = 0;
+            for (const auto &binding : model)
+                if (binding.first == objects[o]->getSymbol())
+                    value = binding.second;
+            values[o].assign(1, value);
+        }
+        hasSolution = true;
+        return true;
+    default:
+        return solver->impl->computeInitialValues(query, objects, values,
+                                                  hasSolution);
+    }
+}
+
+std::unique_ptr<Solver> createFastCexSolver(std::unique_ptr<Solver> s) {
+    return std::make_unique<Solver>(std::make_unique<FastCexSolver>(std::move(s)));
+}
+
+} // namespace miniklee
@@ -0,0 +1,244 @@
+#include "Solver.h"
+
+#include "Constraints.h"
+#include "ExprVisitor.h"
+#include "SolverImpl.h"
+#include "Trace.h"
+
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace miniklee {
+
+namespace {
+
+/// Collects the distinct symbols an expression reads.
+class SymbolCollector : public ExprVisitor<SymbolCollector> {
+public:
+    std::vector<const Symbol *> symbols;
+
+    Action visitPre(const Expr &e) {
+        if (const SymbolicExpr *s = dyn_cast<SymbolicExpr>(&e))
+            symbols.push_back(s->getSymbol());
+        return Continue;
+    }
+};
+
+/// Splits a list of expressions into independent groups: two expressions
+/// are in the same group iff they are linked by a chain of expressions
+/// each sharing a symbol with the next. Union-find over symbol ids.
+class IndependentGroups {
+public:
+    explicit IndependentGroups(const std::vector<ref<Expr>> &exprs)
+        : firstSymbol(exprs.size()) {
+        for (std::size_t i = 0; i < exprs.size(); ++i) {
+            SymbolCollector collector;
+            collector.visit(exprs[i]);
+            const std::vector<const Symbol *> &symbols = collector.symbols;
+            if (symbols.empty())
+                continue;
+            firstSymbol[i] = symbols[0];
+            for (const Symbol *s : symbols)
+                unite(symbols[0]->id, s->id);
+        }
+    }
+
+    /// The group of expression \p i, or -1 if it reads no symbols.
+    int getGroup(std::size_t i) {
+        return firstSymbol[i] ? int(find(firstSymbol[i]->id)) : -1;
+    }
+
+    /// The group of the expressions reading \p symbol, or -1 if none does.
+    int getGroup(const Symbol *symbol) {
+        if (symbol->id >= parent.size() || parent[symbol->id] == None)
+            return -1;
+        return find(symbol->id);
+    }
+
+private:
+    static const unsigned None = ~0u;
+
+    /// Parent of each symbol id in the union-find forest; None if the
+    /// symbol does not occur.
+    std::vector<unsigned> parent;
+    /// Any symbol of each expression, null for those without.
+    std::vector<const Symbol *> firstSymbol;
+
+    unsigned find(unsigned id) {
+        if (id >= parent.size())
+            parent.resize(id + 1, None);
+        if (parent[id] == None)
+            parent[id] = id;
+        // Path halving.
+        while (parent[id] != id) {
+            parent[id] = parent[parent[id]];
+            id = parent[id];
+        }
+        return id;
+    }
+
+    void unite(unsigned a, unsigned b) {
+        a = find(a);
+        b = find(b);
+        if (a != b)
+            parent[b] = a;
+    }
+};
+
+const unsigned IndependentGroups::None;
+
+} // namespace
+
+/// Forwards to the underlying solver only the constraints that can affect
+/// the query expression: those sharing symbols with it, directly or
+/// through other constraints. The others are assumed satisfiable, as a
+/// state's path condition always is.
+///
+/// computeInitialValues solves each independent group separately and
+/// puts the models back together. It assumes nothing: every group is
+/// solved, those without any of the objects too, as the query has no
+/// solution if one of them has none.
+class IndependentSolver : public SolverImpl {
+public:
+    explicit IndependentSolver(std::unique_ptr<Solver> solver)
+        : solver(std::move(solver)) {}
+    ~IndependentSolver();
+
+    bool computeValidity(const Query &, Solver::Validity &result);
+    bool computeTruth(const Query &, bool &isValid);
+    bool computeValue(const Query &, ref<Expr> &result);
+    bool computeInitialValues(const Query &query,
+                              const std::vector<const SymbolicExpr *> &objects,
+                              std::vector<std::vector<int32_t> > &values,
+                              bool &hasSolution);
+    SolverRunStatus getOperationStatusCode() {
+        return solver->impl->getOperationStatusCode();
+    }
+    std::string getConstraintLog(const Query &query) {
+        return solver->impl->getConstraintLog(query);
+    }
+    void setCoreSolverTimeout(time::Span timeout) {
+        solver->impl->setCoreSolverTimeout(timeout);
+    }
+
+private:
+    std::unique_ptr<Solver> solver;
+
+    std::uint64_t constraints = 0, forwarded = 0;
+
+    /// The constraints of \p query relevant to its expression.
+    ConstraintSet slice(const Query &query);
+};
+
+IndependentSolver::~IndependentSolver() {
+    MINIKLEE_TRACE(Solver, Info, "Independence: forwarded {} of {} constraints",
+                   forwarded, constraints);
+}
+
+ConstraintSet IndependentSolver::slice(const Query &query) {
+    std::vector<ref<Expr>> exprs = query.constraints.toVector();
+    exprs.push_back(query.expr);
+    IndependentGroups groups(exprs);
+
+    int group = groups.getGroup(exprs.size() - 1);
+    std::vector<ref<Expr>> relevant;
+    for (std::size_t i = 0; i + 1 < exprs.size(); ++i) {
+        // Constraints without symbols are kept: they cost nothing to
+        // solve and may be false.
+        int g = groups.getGroup(i);
+        if (g == group || g < 0)
+            relevant.push_back(exprs[i]);
+    }
+
+    constraints += exprs.size() - 1;
+    forwarded += relevant.size();
+    return ConstraintSet(relevant);
+}
+
+bool IndependentSolver::computeValidity(const Query &query, Solver::Validity &result) {
+    ConstraintSet relevant = slice(query);
+    return solver->impl->computeValidity(Query(relevant, query.expr), result);
+}
+
+bool IndependentSolver::computeTruth(const Query &query, bool &isValid) {
+    ConstraintSet relevant = slice(query);
+    return solver->impl->computeTruth(Query(relevant, query.expr), isValid);
+}
+
+bool IndependentSolver::computeValue(const Query &query, ref<Expr> &result) {
+    ConstraintSet relevant = slice(query);
+    return solver->impl->computeValue(Query(relevant, query.expr), result);
+}
+
+bool IndependentSolver::computeInitialValues(
+    const Query &query, const std::vector<const SymbolicExpr *> &objects,
+    std::vector<std::vector<int32_t> > &values, bool &hasSolution) {
+    std::vector<ref<Expr>> exprs = query.constraints.toVector();
+    exprs.push_back(query.expr);
+    IndependentGroups groups(exprs);
+
+    constraints += exprs.size() - 1;
+
+    // The members of each group, in order of first appearance.
+    std::vector<std::vector<ref<Expr>>> members;
+    std::unordered_map<int, std::size_t> index;
+    for (std::size_t i = 0; i < exprs.size(); ++i) {
+        int group = groups.getGroup(i);
+        if (group < 0) {
+            // Reads no symbols, so it is a constant.
+            if (exprs[i]->isFalse()) {
+                hasSolution = false;
+                return true;
+            }
+            continue;
+        }
+        auto inserted = index.insert(std::make_pair(group, members.size()));
+        if (inserted.second)
+            members.emplace_back();
+        members[inserted.first->second].push_back(exprs[i]);
+    }
+
+    // Objects no expression reads can take any value.
+    std::vector<std::vector<std::size_t>> indices(members.size());
+    for (std::size_t o = 0; o < objects.size(); ++o) {
+        auto it = index.find(groups.getGroup(objects[o]->getSymbol()));
+        if (it != index.end())
+            indices[it->second].push_back(o);
+        else
+            values[o].assign(1, 0);
+    }
+
+    // Solve every group on its own, with its last member in the query
+    // expression's place: the query expression itself if it belongs to
+    // the group.
+    for (std::size_t g = 0; g < members.size(); ++g) {
+        ref<Expr> expr = members[g].back();
+        members[g].pop_back();
+        forwarded += members[g].size();
+
+        std::vector<const SymbolicExpr *> groupObjects;
+        for (std::size_t o : indices[g])
+            groupObjects.push_back(objects[o]);
+
+        ConstraintSet groupConstraints(members[g]);
+        std::vector<std::vector<int32_t> > groupValues(groupObjects.size());
+        if (!solver->impl->computeInitialValues(Query(groupConstraints, expr),
+                                                groupObjects, groupValues,
+                                                hasSolution))
+            return false;
+        if (!hasSolution)
+            return true;
+        for (std::size_t k = 0; k < indices[g].size(); ++k)
+            values[indices[g][k]] = std::move(groupValues[k]);
+    }
+    hasSolution = true;
+    return true;
+}
+
+std::unique_ptr<Solver> createIndependentSolver(std::unique_ptr<Solver> s) {
+    return std::make_unique<Solver>(std::make_unique<IndependentSolver>(std::move(s)));
+}
+
+} // namespace miniklee
@@ -0,0 +1,167 @@
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/GlobalVariable.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <climits>
+
+#include "KModule.h"
+
+using namespace llvm;
+
+KFunction::KFunction(Function *f) : function(f), numRegisters(0) {
+    // First pass: number the value-producing instructions and find where
+    // every block starts in the decoded stream.
+    std::unordered_map<const BasicBlock *, unsigned> blockEntry;
+    unsigned numInstructions = 0;
+    for (BasicBlock &bb : *f) {
+        blockEntry[&bb] = numInstructions;
+        for (Instruction &i : bb) {
+            if (isa<DbgInfoIntrinsic>(&i))
+                continue;
+            if (!i.getType()->isVoidTy())
+                registerMap[&i] = numRegisters++;
+            ++numInstructions;
+        }
+    }
+
+    // Second pass: decode.
+    instructions.resize(numInstructions);
+    unsigned index = 0;
+    for (BasicBlock &bb : *f) {
+        for (Instruction &i : bb) {
+            if (isa<DbgInfoIntrinsic>(&i))
+                continue;
+            KInstruction &ki = instructions[index++];
+            decode(&i, ki);
+
+            if (BranchInst *bi = dyn_cast<BranchInst>(&i)) {
+                ki.numSuccessors = bi->getNumSuccessors();
+                for (unsigned s = 0; s < ki.numSuccessors; ++s)
+                    ki.successors[s] = blockEntry[bi->getSuccessor(s)];
+            }
+        }
+    }
+}
+
+int KFunction::getOperandNum(Value *v) {
+    if (Instruction *i = dyn_cast<Instruction>(v)) {
+        auto it = registerMap.find(i);
+        assert(it != registerMap.end() && "Operand has no register");
+        return it->second;
+    }
+
+    if (ConstantInt *ci = dyn_cast<ConstantInt>(v)) {
+        auto it = constantMap.find(ci);
+        unsigned index;
+        if (it != constantMap.end()) {
+            index = it->second;
+        } else {
+            assert(ci->getType()->isIntegerTy(32) && "Int32 expected");
+            index = constants.size();
+            constants.push_back(miniklee::ConstantExpr::create(
+                static_cast<int32_t>(ci->getSExtValue()), Expr::Int32));
+            constantMap[ci] = index;
+        }
+        return -static_cast<int>(index) - 1;
+    }
+
+    assert(false && "Unsupported operand");
+    return 0;
+}
+
+void KFunction::decode(Instruction *i, KInstruction &ki) {
+    ki.opcode = i->getOpcode();
+    ki.predicate = 0;
+    ki.numOperands = 0;
+    ki.numSuccessors = 0;
+    ki.symbolName = 0;
+    ki.inst = i;
+
+    auto it = registerMap.find(i);
+    ki.dest = it != registerMap.end() ? it->second : KInstruction::NoRegister;
+
+    switch (ki.opcode) {
+    case Instruction::Br: {
+        BranchInst *bi = cast<BranchInst>(i);
+        if (bi->isConditional()) {
+            assert(bi->getCondition() == bi->getOperand(0) &&
+                    "Wrong operand index!");
+            assert(isa<Instruction>(bi->getCondition()));
+            ki.operands[ki.numOperands++] = getOperandNum(bi->getCondition());
+        }
+        break;
+    }
+    case Instruction::Call: {
+        const CallBase *cb = cast<CallBase>(i);
+        assert(cb->getCalledFunction()->getName() == "make_symbolic"
+                && "Unknown call instruction");
+        assert(cb->arg_size()  == 3 && "Unexpected Error");
+
+        // 1. Make symbolic
+        assert(isa<Instruction>(cb->getArgOperand(0)) &&
+                "First argument should be a variable (Instruction type)");
+        ki.operands[ki.numOperands++] = getOperandNum(cb->getArgOperand(0));
+
+        // 2. Deal with the size (4 bytes)
+        ConstantInt *size = dyn_cast<ConstantInt>(cb->getArgOperand(1));
+        assert(size->getSExtValue() == Expr::Int32 / CHAR_BIT);
+        (void) size;
+
+        // 3. Retrieve the name from the GEP constant expression
+        auto *gepExpr = cast<llvm::ConstantExpr>(cb->getArgOperand(2));
+        assert(gepExpr->getOpcode() == llvm::Instruction::GetElementPtr && "GEP Expected");
+        auto *globalVar = cast<GlobalVariable>(gepExpr->getOperand(0));
+        auto *strArray = cast<ConstantDataArray>(globalVar->getInitializer());
+        assert(strArray->isString() && "String Expected");
+
+        ki.symbolName = symbolNames.size();
+        symbolNames.push_back(strArray->getAsString().str());
+        break;
+    }
+    case Instruction::Alloca: {
+        assert("Support Int32 type only"
+                && cast<AllocaInst>(i)->getAllocatedType()
+                    == Type::getInt32Ty(i->getContext()));
+        break;
+    }
+    case Instruction::Load: {
+        LoadInst *li = cast<LoadInst>(i);
+        assert(isa<Instruction>(li->getPointerOperand()) && "Pointer Operand expected");
+        ki.operands[ki.numOperands++] = getOperandNum(li->getPointerOperand());
+        break;
+    }
+    case Instruction::Store: {
+        StoreInst *si = cast<StoreInst>(i);
+        assert(isa<Instruction>(si->getPointerOperand()) && "Target is not an Instruction");
+        ki.operands[ki.numOperands++] = getOperandNum(si->getValueOperand());
+        ki.operands[ki.numOperands++] = getOperandNum(si->getPointerOperand());
+        break;
+    }
+    case Instruction::Add:
+    case Instruction::Sub: {
+        ki.operands[ki.numOperands++] = getOperandNum(i->getOperand(0));
+        ki.operands[ki.numOperands++] = getOperandNum(i->getOperand(1));
+        break;
+    }
+    case Instruction::ICmp: {
+        ki.predicate = cast<ICmpInst>(i)->getPredicate();
+        ki.operands[ki.numOperands++] = getOperandNum(i->getOperand(0));
+        ki.operands[ki.numOperands++] = getOperandNum(i->getOperand(1));
+        break;
+    }
+    default:
+        // Left for the executor to report.
+        break;
+    }
+}
+
+KFunction *KModule::getKFunction(Function *f) {
+    auto it = functionMap.find(f);
+    if (it != functionMap.end())
+        return it->second.get();
+
+    KFunction *kf = new KFunction(f);
+    functionMap[f] = std::unique_ptr<KFunction>(kf);
+    return kf;
+}
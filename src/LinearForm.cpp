@@ -0,0 +1,184 @@
+#include "LinearForm.h"
+
+#include <memory>
+#include <utility>
+
+using namespace miniklee;
+
+namespace {
+/// Cached in place of a form for nodes that are not linear.
+const LinearForm NonLinear(0);
+} // namespace
+
+BinaryExpr::~BinaryExpr() {
+    const LinearForm *form = linearForm.load(std::memory_order_relaxed);
+    if (form != &NonLinear)
+        delete form;
+}
+
+void LinearForm::addTerm(const Symbol *symbol, std::uint64_t coefficient) {
+    coefficient &= mask();
+    if (coefficient == 0)
+        return;
+    auto it = terms.begin();
+    while (it != terms.end() && it->symbol->id < symbol->id)
+        ++it;
+    if (it != terms.end() && it->symbol == symbol) {
+        it->coefficient = (it->coefficient + coefficient) & mask();
+        if (it->coefficient == 0)
+            terms.erase(it);
+        return;
+    }
+    terms.insert(it, Term{symbol, coefficient});
+}
+
+void LinearForm::addScaled(const LinearForm &f, std::uint64_t scale) {
+    constant = (constant + f.constant * scale) & mask();
+
+    // Merge the two sorted term lists.
+    std::vector<Term> merged;
+    merged.reserve(terms.size() + f.terms.size());
+    auto a = terms.cbegin();
+    auto b = f.terms.cbegin();
+    while (a != terms.cend() || b != f.terms.cend()) {
+        if (b == f.terms.cend() || (a != terms.cend() && a->symbol->id < b->symbol->id)) {
+            merged.push_back(*a++);
+            continue;
+        }
+        std::uint64_t coefficient = (b->coefficient * scale) & mask();
+        if (a != terms.cend() && a->symbol == b->symbol)
+            coefficient = (coefficient + (a++)->coefficient) & mask();
+        if (coefficient != 0)
+            merged.push_back(Term{b->symbol, coefficient});
+        ++b;
+    }
+    terms = std::move(merged);
+}
+
+bool LinearForm::add(const Expr *e, std::uint64_t scale) {
+    switch (e->getKind()) {
+    case Expr::Constant: {
+        const ConstantExpr *c = cast<ConstantExpr>(e);
+        if (c->isWide())
+            return false;
+        constant = (constant + c->getZExtValue() * scale) & mask();
+        return true;
+    }
+    case Expr::Symbolic:
+        addTerm(cast<SymbolicExpr>(e)->getSymbol(), scale);
+        return true;
+    case Expr::Add:
+    case Expr::Sub:
+    case Expr::Mul: {
+        const LinearForm *f = get(cast<BinaryExpr>(e));
+        if (!f)
+            return false;
+        addScaled(*f, scale);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+std::int64_t LinearForm::getSignedConstant() const {
+    if (width >= 64)
+        return static_cast<std::int64_t>(constant);
+    return llvm::SignExtend64(constant, width);
+}
+
+ref<Expr> LinearForm::toExpr() const {
+    ref<Expr> sum;
+    for (auto it = terms.rbegin(); it != terms.rend(); ++it) {
+        ref<Expr> term = SymbolicExpr::alloc(it->symbol);
+        if (it->coefficient != 1)
+            term = MulExpr::alloc(ConstantExpr::create(it->coefficient, width), term);
+        sum = sum.isNull() ? term : AddExpr::alloc(term, sum);
+    }
+    if (sum.isNull())
+        return ConstantExpr::create(constant, width);
+    if (constant != 0)
+        sum = AddExpr::alloc(ConstantExpr::create(constant, width), sum);
+    return sum;
+}
+
+bool LinearForm::addOperation(Expr::Kind kind, const Expr *l, const Expr *r) {
+    switch (kind) {
+    case Expr::Add:
+        return add(l) && add(r);
+    case Expr::Sub:
+        return add(l) && add(r, -1);
+    case Expr::Mul:
+        if (const ConstantExpr *c = dyn_cast<ConstantExpr>(l))
+            return add(r, c->getZExtValue());
+        if (const ConstantExpr *c = dyn_cast<ConstantExpr>(r))
+            return add(l, c->getZExtValue());
+        return false;
+    default:
+        return false;
+    }
+}
+
+/// Compute the form of \p e from the cached forms of its kids.
+const LinearForm *LinearForm::compute(const BinaryExpr *e) {
+    if (e->getWidth() > 64)
+        return &NonLinear;
+    std::unique_ptr<LinearForm> form(new LinearForm(e->getWidth()));
+    if (!form->addOperation(e->getKind(), e->left.get(), e->right.get()))
+        return &NonLinear;
+    return form.release();
+}
+
+const LinearForm *LinearForm::get(const BinaryExpr *e) {
+    const LinearForm *form = e->linearForm.load(std::memory_order_acquire);
+    if (!form) {
+        // Fill in uncached kids first, bottom up with an explicit stack,
+        // so compute() never recurses: nodes built with alloc() rather
+        // than create() may form long chains without cached forms.
+        std::vector<std::pair<const BinaryExpr *, bool>> stack;
+        stack.emplace_back(e, false);
+        while (!stack.empty()) {
+            const BinaryExpr *node = stack.back().first;
+            if (!stack.back().second) {
+                stack.back().second = true;
+                for (const Expr *kid : {node->left.get(), node->right.get()}) {
+                    Expr::Kind k = kid->getKind();
+                    if ((k == Expr::Add || k == Expr::Sub || k == Expr::Mul) &&
+                        !cast<BinaryExpr>(kid)->linearForm.load(std::memory_order_acquire))
+                        stack.emplace_back(cast<BinaryExpr>(kid), false);
+                }
+                continue;
+            }
+            stack.pop_back();
+
+            const LinearForm *expected = nullptr;
+            const LinearForm *computed = compute(node);
+            if (!node->linearForm.compare_exchange_strong(expected, computed,
+                                                          std::memory_order_acq_rel) &&
+                computed != &NonLinear)
+                delete computed; // another thread got there first
+        }
+        form = e->linearForm.load(std::memory_order_acquire);
+    }
+    return form == &NonLinear ? nullptr : form;
+}
+
+ref<Expr> LinearForm::combine(Expr::Kind kind, const ref<Expr> &l, const ref<Expr> &r) {
+    if (l->getWidth() > 64)
+        return ref<Expr>();
+
+    LinearForm form(l->getWidth());
+    if (!form.addOperation(kind, l.get(), r.get()))
+        return ref<Expr>();
+
+    ref<Expr> result = form.toExpr();
+    // Hand the form over to the new node rather than recomputing it.
+    if (BinaryExpr *be = dyn_cast<BinaryExpr>(result.get())) {
+        const LinearForm *expected = nullptr;
+        LinearForm *cached = new LinearForm(std::move(form));
+        if (!be->linearForm.compare_exchange_strong(expected, cached,
+                                                    std::memory_order_acq_rel))
+            delete cached;
+    }
+    return result;
+}
@@ -0,0 +1,86 @@
+#include <thread>
+
+#include "Executor.h"
+#include "ExecutionState.h"
+
+using namespace llvm;
+using namespace miniklee;
+
+void Executor::runFunctionAsMainParallel(Function *function, unsigned numThreads) {
+    assert(numThreads > 0);
+
+    // Decode up front: the KModule is read-only once workers run.
+    KFunction *kf = kmodule->getKFunction(function);
+
+    std::vector<std::unique_ptr<WorkStealingQueue>> queues;
+    std::vector<std::unique_ptr<Executor>> workers;
+    for (unsigned i = 0; i < numThreads; ++i) {
+        queues.emplace_back(new WorkStealingQueue());
+        workers.push_back(createWorker());
+    }
+
+    std::atomic<std::size_t> liveStates(1);
+    queues[0]->push(new ExecutionState(kf));
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < numThreads; ++i)
+        threads.emplace_back([&, i] { workers[i]->runWorker(i, queues, liveStates); });
+    for (std::thread &t : threads)
+        t.join();
+
+    for (auto &worker : workers)
+        pathsExplored += worker->pathsExplored;
+}
+
+void Executor::runWorker(unsigned id,
+                         std::vector<std::unique_ptr<WorkStealingQueue>> &queues,
+                         std::atomic<std::size_t> &liveStates) {
+    WorkStealingQueue &own = *queues[id];
+    unsigned numQueues = queues.size();
+    ExecutionState *state = nullptr;
+
+    Expr::setDeferredReclamation(true);
+
+    while (true) {
+        if (!state)
+            state = own.pop();
+        for (unsigned k = 1; !state && k < numQueues; ++k)
+            state = queues[(id + k) % numQueues]->steal();
+
+        if (!state) {
+            // Every live state is held by some worker; once none are left
+            // no more can appear.
+            if (liveStates.load(std::memory_order_acquire) == 0)
+                break;
+            // Idle: free everything still queued.
+            Expr::reclaimPending();
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Keep running the same state until it terminates; the states it
+        // forks off are published for stealing.
+        KInstIterator ki = state->pc;
+        stepInstruction(*state);
+        executeInstruction(*state, ki);
+
+        for (ExecutionState *es : addedStates) {
+            liveStates.fetch_add(1, std::memory_order_relaxed);
+            own.push(es);
+        }
+        addedStates.clear();
+
+        for (ExecutionState *es : removedStates) {
+            if (es == state)
+                state = nullptr;
+            delete es;
+            ++pathsExplored;
+            liveStates.fetch_sub(1, std::memory_order_acq_rel);
+        }
+        removedStates.clear();
+
+        Expr::reclaimPending(ReclaimBudget);
+    }
+
+    Expr::setDeferredReclamation(false);
+}
@@ -0,0 +1,270 @@
+#include "Searcher.h"
+#include "ExecutionState.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+///
+
+ExecutionState &DFSSearcher::selectState() {
+    assert(!states.empty());
+    return *states.back();
+}
+
+void DFSSearcher::update(ExecutionState *current,
+                         const std::vector<ExecutionState *> &addedStates,
+                         const std::vector<ExecutionState *> &removedStates) {
+    for (ExecutionState *es : addedStates)
+        positions[es] = states.insert(states.end(), es);
+
+    for (ExecutionState *es : removedStates) {
+        auto it = positions.find(es);
+        assert(it != positions.end() && "invalid state removed");
+        states.erase(it->second);
+        positions.erase(it);
+    }
+}
+
+///
+
+ExecutionState &BFSSearcher::selectState() {
+    assert(!states.empty());
+    return *states.front();
+}
+
+void BFSSearcher::update(ExecutionState *current,
+                         const std::vector<ExecutionState *> &addedStates,
+                         const std::vector<ExecutionState *> &removedStates) {
+    // A forking state is moved behind the states that were waiting, so the
+    // tree is explored level by level.
+    if (!addedStates.empty() && current &&
+        std::find(removedStates.begin(), removedStates.end(), current) == removedStates.end()) {
+        auto pos = positions.find(current);
+        assert(pos != positions.end() && "current state not in searcher");
+        states.splice(states.end(), states, pos->second);
+    }
+
+    for (ExecutionState *es : addedStates)
+        positions[es] = states.insert(states.end(), es);
+
+    for (ExecutionState *es : removedStates) {
+        auto it = positions.find(es);
+        assert(it != positions.end() && "invalid state removed");
+        states.erase(it->second);
+        positions.erase(it);
+    }
+}
+
+///
+
+ExecutionState &RandomSearcher::selectState() {
+    assert(!states.empty());
+    std::uniform_int_distribution<size_t> dist(0, states.size() - 1);
+    return *states[dist(rng)];
+}
+
+void RandomSearcher::update(ExecutionState *current,
+                            const std::vector<ExecutionState *> &addedStates,
+                            const std::vector<ExecutionState *> &removedStates) {
+    for (ExecutionState *es : addedStates) {
+        positions[es] = states.size();
+        states.push_back(es);
+    }
+
+    // Order does not matter, so remove by swapping with the last state.
+    for (ExecutionState *es : removedStates) {
+        auto it = positions.find(es);
+        assert(it != positions.end() && "invalid state removed");
+        size_t pos = it->second;
+        positions.erase(it);
+        if (pos != states.size() - 1) {
+            states[pos] = states.back();
+            positions[states[pos]] = pos;
+        }
+        states.pop_back();
+    }
+}
+
+///
+
+void DiscretePDF::add(size_t slot, double delta) {
+    for (size_t i = slot + 1; i < tree.size(); i += i & -i)
+        tree[i] += delta;
+}
+
+void DiscretePDF::grow() {
+    size_t capacity = items.empty() ? 16 : items.size() * 2;
+    for (size_t slot = capacity; slot-- > items.size();)
+        freeSlots.push_back(slot);
+    items.resize(capacity, nullptr);
+    weights.resize(capacity, 0.0);
+
+    // Rebuild the tree in O(n).
+    tree.assign(capacity + 1, 0.0);
+    for (size_t i = 1; i <= capacity; ++i) {
+        tree[i] += weights[i - 1];
+        size_t parent = i + (i & -i);
+        if (parent <= capacity)
+            tree[parent] += tree[i];
+    }
+}
+
+void DiscretePDF::insert(ExecutionState *item, double weight) {
+    assert(!slots.count(item) && "item already present");
+    if (freeSlots.empty())
+        grow();
+    size_t slot = freeSlots.back();
+    freeSlots.pop_back();
+
+    slots[item] = slot;
+    items[slot] = item;
+    weights[slot] = weight;
+    add(slot, weight);
+}
+
+void DiscretePDF::remove(ExecutionState *item) {
+    auto it = slots.find(item);
+    assert(it != slots.end() && "item not present");
+    size_t slot = it->second;
+    slots.erase(it);
+
+    add(slot, -weights[slot]);
+    weights[slot] = 0.0;
+    items[slot] = nullptr;
+    freeSlots.push_back(slot);
+}
+
+void DiscretePDF::update(ExecutionState *item, double weight) {
+    auto it = slots.find(item);
+    assert(it != slots.end() && "item not present");
+    size_t slot = it->second;
+    add(slot, weight - weights[slot]);
+    weights[slot] = weight;
+}
+
+ExecutionState *DiscretePDF::choose(double p) const {
+    assert(!empty());
+    size_t capacity = items.size();
+
+    double total = 0.0;
+    for (size_t i = capacity; i > 0; i -= i & -i)
+        total += tree[i];
+    double target = p * total;
+
+    // Find the first slot whose prefix sum exceeds target.
+    size_t pos = 0;
+    for (size_t step = capacity; step > 0; step >>= 1) {
+        if (pos + step <= capacity && tree[pos + step] <= target) {
+            target -= tree[pos + step];
+            pos += step;
+        }
+    }
+
+    // Rounding can walk past the last live slot.
+    if (pos >= capacity || !items[pos])
+        return slots.begin()->first;
+    return items[pos];
+}
+
+///
+
+double WeightedRandomSearcher::getWeight(ExecutionState *es) {
+    switch (type) {
+    case Depth:
+        return es->depth + 1;
+    case RandomPath: {
+        double w = std::ldexp(1.0, -static_cast<int>(es->depth));
+        return w > 0.0 ? w : DBL_MIN;
+    }
+    }
+    assert(false && "invalid weight type");
+    return 1.0;
+}
+
+ExecutionState &WeightedRandomSearcher::selectState() {
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
+    return *states.choose(dist(rng));
+}
+
+void WeightedRandomSearcher::update(ExecutionState *current,
+                                    const std::vector<ExecutionState *> &addedStates,
+                                    const std::vector<ExecutionState *> &removedStates) {
+    // The depth of current changes when it forks.
+    if (current && !addedStates.empty() &&
+        std::find(removedStates.begin(), removedStates.end(), current) == removedStates.end())
+        states.update(current, getWeight(current));
+
+    for (ExecutionState *es : addedStates)
+        states.insert(es, getWeight(es));
+
+    for (ExecutionState *es : removedStates)
+        states.remove(es);
+}
+
+void WeightedRandomSearcher::printName(llvm::raw_ostream &os) {
+    os << "WeightedRandomSearcher::";
+    switch (type) {
+    case Depth: os << "Depth\n"; return;
+    case RandomPath: os << "RandomPath\n"; return;
+    }
+}
+
+///
+
+InterleavedSearcher::InterleavedSearcher(std::vector<std::unique_ptr<Searcher>> searchers)
+    : searchers(std::move(searchers)) {
+    assert(!this->searchers.empty());
+}
+
+ExecutionState &InterleavedSearcher::selectState() {
+    Searcher *s = searchers[index].get();
+    index = (index + 1) % searchers.size();
+    return s->selectState();
+}
+
+void InterleavedSearcher::update(ExecutionState *current,
+                                 const std::vector<ExecutionState *> &addedStates,
+                                 const std::vector<ExecutionState *> &removedStates) {
+    for (auto &searcher : searchers)
+        searcher->update(current, addedStates, removedStates);
+}
+
+void InterleavedSearcher::printName(llvm::raw_ostream &os) {
+    os << "<InterleavedSearcher> containing " << searchers.size() << " searchers:\n";
+    for (auto &searcher : searchers)
+        searcher->printName(os);
+    os << "</InterleavedSearcher>\n";
+}
+
+///
+
+static std::unique_ptr<Searcher> createSearcher(SearcherType type, std::mt19937 &rng) {
+    switch (type) {
+    case SearcherType::DFS:
+        return std::make_unique<DFSSearcher>();
+    case SearcherType::BFS:
+        return std::make_unique<BFSSearcher>();
+    case SearcherType::RandomState:
+        return std::make_unique<RandomSearcher>(rng);
+    case SearcherType::NURS_Depth:
+        return std::make_unique<WeightedRandomSearcher>(WeightedRandomSearcher::Depth, rng);
+    case SearcherType::NURS_RP:
+        return std::make_unique<WeightedRandomSearcher>(WeightedRandomSearcher::RandomPath, rng);
+    }
+    assert(false && "invalid searcher type");
+    return nullptr;
+}
+
+std::unique_ptr<Searcher> createSearcher(const std::vector<SearcherType> &types,
+                                         std::mt19937 &rng) {
+    assert(!types.empty());
+    if (types.size() == 1)
+        return createSearcher(types[0], rng);
+
+    std::vector<std::unique_ptr<Searcher>> searchers;
+    for (SearcherType type : types)
+        searchers.push_back(createSearcher(type, rng));
+    return std::make_unique<InterleavedSearcher>(std::move(searchers));
+}
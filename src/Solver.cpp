@@ -27,15 +27,16 @@ void Solver::setCoreSolverTimeout(time::Span timeout) {
     impl->setCoreSolverTimeout(timeout);
 }
 
-bool Solver::evaluate(const Query& query) {
+bool Solver::evaluate(const Query& query, Validity &result) {
+    assert(query.expr->getWidth() == Expr::Bool && "Invalid expression type!");
+
     // Maintain invariants implementations expect.
     if (ConstantExpr *CE = dyn_cast<ConstantExpr>(query.expr.get())) {
-        if (CE->isTrue())
-            return true;
-        else
-            return false;
+        result = CE->isTrue() ? True : False;
+        return true;
     }
-    return impl->computeValidity(query);
+
+    return impl->computeValidity(query, result);
 }
 
 bool Solver::mustBeTrue(const Query& query, bool &result) {
@@ -78,9 +79,11 @@ bool
 Solver::getInitialValues(const Query& query,
                             const std::vector<const SymbolicExpr*> &objects,
                             std::vector< std::vector<int32_t> > &values) {
+    bool hasSolution;
     bool success =
-        impl->computeInitialValues(query, objects, values);
-    return success;
+        impl->computeInitialValues(query, objects, values, hasSolution);
+    // FIXME: Propagate this out.
+    return success && hasSolution;
 }
 
 std::pair< ref<Expr>, ref<Expr> > Solver::getRange(const Query& query) {
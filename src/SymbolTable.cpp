@@ -0,0 +1,64 @@
+#include "SymbolTable.h"
+
+#include "llvm/Support/xxhash.h"
+
+#include <cassert>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+using namespace miniklee;
+
+namespace {
+struct Table {
+    std::mutex lock;
+    std::unordered_map<std::string, Symbol *> byName;
+    std::vector<Symbol *> byId;
+};
+
+Table &getTable() {
+    // Never destroyed: symbols are referenced by expressions that may die
+    // during static destruction.
+    static Table *table = new Table();
+    return *table;
+}
+} // namespace
+
+Symbol::Symbol(unsigned id, const std::string &name, unsigned width, unsigned size)
+    : id(id), name(name), width(width), size(size), hash(llvm::xxHash64(name)) {}
+
+const Symbol *SymbolTable::get(const std::string &name, unsigned width, unsigned size) {
+    Table &table = getTable();
+    std::lock_guard<std::mutex> guard(table.lock);
+    auto it = table.byName.find(name);
+    if (it != table.byName.end()) {
+        assert(it->second->width == width && it->second->size == size &&
+               "Symbol redeclared with a different shape");
+        return it->second;
+    }
+
+    Symbol *symbol = new Symbol(table.byId.size(), name, width, size);
+    table.byName.emplace(name, symbol);
+    table.byId.push_back(symbol);
+    return symbol;
+}
+
+const Symbol *SymbolTable::find(const std::string &name) {
+    Table &table = getTable();
+    std::lock_guard<std::mutex> guard(table.lock);
+    auto it = table.byName.find(name);
+    return it == table.byName.end() ? nullptr : it->second;
+}
+
+const Symbol *SymbolTable::lookup(unsigned id) {
+    Table &table = getTable();
+    std::lock_guard<std::mutex> guard(table.lock);
+    assert(id < table.byId.size() && "Unknown symbol id");
+    return table.byId[id];
+}
+
+unsigned SymbolTable::size() {
+    Table &table = getTable();
+    std::lock_guard<std::mutex> guard(table.lock);
+    return table.byId.size();
+}
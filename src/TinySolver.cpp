@@ -1,6 +1,10 @@
 #include "Solver.h"
 #include "Constraints.h"
+#include "LinearForm.h"
 #include "SolverImpl.h"
+#include "Trace.h"
+
+#include "llvm/Support/ErrorHandling.h"
 
 #include <memory>
 #include <random>
@@ -8,33 +12,88 @@
 
 namespace miniklee {
 
+namespace {
+/// Values the solved-for object may take, as disjoint intervals [lo, hi]
+/// of its 32-bit pattern in ascending order.
+typedef std::vector<std::pair<std::uint64_t, std::uint64_t>> ValueSet;
+
+const std::uint64_t NumValues = std::uint64_t(1) << 32;
+
+/// The \p length values from \p start upwards, wrapping around.
+ValueSet makeArc(std::uint32_t start, std::uint64_t length) {
+    if (length == 0)
+        return {};
+    std::uint64_t last = start + length - 1;
+    if (last < NumValues)
+        return {{start, last}};
+    return {{0, last - NumValues}, {start, NumValues - 1}};
+}
+
+ValueSet intersect(const ValueSet &a, const ValueSet &b) {
+    ValueSet res;
+    for (auto i = a.begin(), j = b.begin(); i != a.end() && j != b.end();) {
+        std::uint64_t lo = std::max(i->first, j->first);
+        std::uint64_t hi = std::min(i->second, j->second);
+        if (lo <= hi)
+            res.push_back({lo, hi});
+        if (i->second < j->second)
+            ++i;
+        else
+            ++j;
+    }
+    return res;
+}
+
+/// Reduce \p e to c + k * x, taking every symbol for x.
+bool getLinear(const ref<Expr> &e, std::uint32_t &c, std::uint32_t &k) {
+    LinearForm form(e->getWidth());
+    if (!form.add(e.get()))
+        return false;
+    c = static_cast<std::uint32_t>(form.constant);
+    k = 0;
+    for (const LinearForm::Term &t : form.terms)
+        k += static_cast<std::uint32_t>(t.coefficient);
+    return true;
+}
+
+[[noreturn]] void unsupported(const ref<Expr> &e) {
+    std::string message;
+    llvm::raw_string_ostream os(message);
+    os << "TinySolver: unsupported constraint of kind ";
+    Expr::printKind(os, e->getKind());
+    os << "; only linear Eq and Ne, and ordered comparisons of x + c or c - x "
+          "against a constant, over 32 bits, are solved";
+    llvm::report_fatal_error(os.str());
+}
+} // namespace
+
 class TinySolverImpl : public SolverImpl {
 public:
     TinySolverImpl();
 
-    bool computeValidity(const Query &);
     bool computeTruth(const Query &, bool &isValid);
     bool computeValue(const Query &, ref<Expr> &result);
     bool computeInitialValues(const Query &,
                                 const std::vector<const SymbolicExpr *> &objects,
-                                std::vector<std::vector<int32_t> > &values);
+                                std::vector<std::vector<int32_t> > &values,
+                                bool &hasSolution);
     bool internalRunSolver(const Query &query, 
                             const std::vector<const SymbolicExpr *> *objects,
                             std::vector<std::vector<int32_t> > *values);
     void solveConstraint(const ref<Expr> &e, int32_t &res);
+    /// The values satisfying the ordered comparison \p e, or its negation
+    /// if \p negated.
+    ValueSet solveRange(const ref<Expr> &e, bool negated);
     SolverRunStatus getOperationStatusCode();
     int32_t generateRandomExcluding(const std::vector<int32_t>& cannot);
-    std::pair<int32_t, int32_t> evaluate(ref<Expr> e);
 };
 
 TinySolverImpl::TinySolverImpl() {}
 
-bool TinySolverImpl::computeValidity(const Query &query) {
-    return internalRunSolver(query, NULL /* objects */, NULL /* values */);
-}
-
-bool TinySolverImpl::computeTruth(const Query &, bool &isValid) {
-    return false;
+bool TinySolverImpl::computeTruth(const Query &query, bool &isValid) {
+    // Valid iff the negated query has no solution.
+    isValid = !internalRunSolver(query.negateExpr(), NULL /* objects */, NULL /* values */);
+    return true;
 }
 
 bool TinySolverImpl::computeValue(const Query &, ref<Expr> &result) {
@@ -43,10 +102,12 @@ bool TinySolverImpl::computeValue(const Query &, ref<Expr> &result) {
 
 bool TinySolverImpl::computeInitialValues(
     const Query &query, const std::vector<const SymbolicExpr *> &objects,
-    std::vector<std::vector<int32_t> > &values) {
-    assert(objects.size() == 1 && "Currently support only one object");
-    assert(values.size()  == 1 && "Currently support only one object");
-    return internalRunSolver(query, &objects,  &values);
+    std::vector<std::vector<int32_t> > &values, bool &hasSolution) {
+    // Every symbol stands for the one object being solved for (see
+    // solveConstraint), so all objects get the same value.
+    assert(objects.size() == values.size() && "One value per object");
+    hasSolution = internalRunSolver(query, &objects,  &values);
+    return true;
 }
 
 bool TinySolverImpl::internalRunSolver(
@@ -56,114 +117,183 @@ bool TinySolverImpl::internalRunSolver(
     int32_t res;
     bool assigned = false; // Record whether the res is assigned
     std::vector<int32_t> cannot;
+    // Narrowed by the ordered comparisons, if there are any.
+    ValueSet allowed = makeArc(0, NumValues);
+    bool ordered = false;
 
-    // Deal with current branch condition
-    if (query.expr->getKind() == Expr::Eq) {
-        solveConstraint(query.expr, res);
-        assigned = true;
-    } else if (query.expr->getKind() == Expr::Not){
-        int32_t cannotbe;
-        solveConstraint(query.expr->getKid(0), cannotbe);
-        cannot.push_back(cannotbe);
-    } else assert(false && "This compare expression currently not support");
-
-    for (auto c : query.constraints) {
+    // The current branch condition first, then the path constraints.
+    auto addCondition = [&](const ref<Expr> &c) {
         if (c->getKind() == Expr::Eq) {
             int32_t prev;
             solveConstraint(c, prev);
             if (assigned && (res != prev)) return false;
-            else {
-                res = prev;
-                assigned = true;
-            }
-        } else if (c->getKind() == Expr::Not) {
+            res = prev;
+            assigned = true;
+        } else if (c->getKind() == Expr::Not &&
+                   c->getKid(0)->getKind() == Expr::Eq) {
             int32_t cannotbe;
             solveConstraint(c->getKid(0), cannotbe);
             if (assigned && (res == cannotbe)) return false;
             cannot.push_back(cannotbe);
-        } else assert(false && "This compare expression currently not support");
+        } else if (c->getKind() == Expr::Not) {
+            allowed = intersect(allowed, solveRange(c->getKid(0), true));
+            ordered = true;
+        } else {
+            allowed = intersect(allowed, solveRange(c, false));
+            ordered = true;
+        }
+        return !allowed.empty();
+    };
+
+    if (!addCondition(query.expr))
+        return false;
+    for (auto it = query.constraints.newest_begin(), ie = query.constraints.newest_end();
+         it != ie; ++it) {
+        if (!addCondition(*it))
+            return false;
+    }
+
+    std::sort(cannot.begin(), cannot.end());
+    auto excluded = [&](std::uint64_t v) {
+        return std::binary_search(cannot.begin(), cannot.end(),
+                                  static_cast<int32_t>(static_cast<std::uint32_t>(v)));
+    };
+
+    if (assigned) {
+        std::uint64_t v = static_cast<std::uint32_t>(res);
+        if (excluded(v))
+            return false;
+        auto in = [v](const std::pair<std::uint64_t, std::uint64_t> &i) {
+            return i.first <= v && v <= i.second;
+        };
+        if (std::none_of(allowed.begin(), allowed.end(), in))
+            return false;
+    } else if (!ordered) {
+        res = generateRandomExcluding(cannot);
+    } else {
+        // The lowest allowed value that no Ne rules out.
+        bool found = false;
+        for (auto it = allowed.begin(); !found && it != allowed.end(); ++it) {
+            for (std::uint64_t v = it->first; v <= it->second; ++v) {
+                if (!excluded(v)) {
+                    res = static_cast<int32_t>(static_cast<std::uint32_t>(v));
+                    found = true;
+                    break;
+                }
+            }
+        }
+        if (!found)
+            return false;
     }
 
     if (objects && values) {
-        if (!assigned)
-            res = generateRandomExcluding(cannot);
-        values->front().push_back(res);
+        for (std::vector<int32_t> &v : *values)
+            v.push_back(res);
+    }
 
-        llvm::errs() << "Assigning " << res << " " << "\n";
+    MINIKLEE_TRACE(Solver, Debug, "Assigning {}", res);
+    return true;
+}
+
+ValueSet TinySolverImpl::solveRange(const ref<Expr> &e, bool negated) {
+    bool isSigned;
+    switch (e->getKind()) {
+    case Expr::Ult:
+    case Expr::Ule:
+        isSigned = false;
+        break;
+    case Expr::Slt:
+    case Expr::Sle:
+        isSigned = true;
+        break;
+    default:
+        unsupported(e);
     }
+    bool strict = e->getKind() == Expr::Ult || e->getKind() == Expr::Slt;
 
-    {
-        if (!assigned)
-            res = generateRandomExcluding(cannot);
+    ref<Expr> left = e->getKid(0);
+    ref<Expr> right = e->getKid(1);
+    std::uint32_t lc, lk, rc, rk;
+    if (left->getWidth() != Expr::Int32 || !getLinear(left, lc, lk) ||
+        !getLinear(right, rc, rk))
+        unsupported(e);
 
-        llvm::errs() << "Assigning " << res << " " << "\n";
+    // Signed order is unsigned order with the sign bit flipped.
+    std::uint32_t bias = isSigned ? 0x80000000u : 0;
+    std::uint32_t start;
+    std::uint64_t length;
+    std::uint32_t c, k;
+    if (lk == 0 && rk == 0) {
+        bool holds = strict ? (lc ^ bias) < (rc ^ bias) : (lc ^ bias) <= (rc ^ bias);
+        start = 0;
+        length = holds ? NumValues : 0;
+        c = 0;
+        k = 1;
+    } else if (rk == 0) {
+        // c + k * x < K: from the bottom of the order up to K.
+        std::uint32_t bound = rc ^ bias;
+        start = bias;
+        length = std::uint64_t(bound) + (strict ? 0 : 1);
+        c = lc;
+        k = lk;
+    } else if (lk == 0) {
+        // K < c + k * x: from K to the top of the order.
+        std::uint32_t bound = lc ^ bias;
+        start = (bound + (strict ? 1 : 0)) ^ bias;
+        length = NumValues - bound - (strict ? 1 : 0);
+        c = rc;
+        k = rk;
+    } else {
+        unsupported(e);
     }
-    return true;
+    if (k != 1 && k != 0xffffffffu)
+        unsupported(e);
+
+    if (negated) {
+        start += static_cast<std::uint32_t>(length);
+        length = NumValues - length;
+    }
+    if (length == 0)
+        return {};
+
+    // From the values of c + k * x to those of x.
+    if (k == 1)
+        start -= c;
+    else
+        start = c - (start + static_cast<std::uint32_t>(length - 1));
+    return makeArc(start, length);
 }
 
 /// FIXME: This is a naive Implementation
 void TinySolverImpl::solveConstraint(const ref<Expr> &e, int32_t &res) {
     assert(e->getKind() == Expr::Eq && "Constraint must be an equality");
     // Solving equaltation (X1 == X2)
-    // where 
-    //      X => X | X1 + X2 | X1 - X2
-    //      Y => symbolic | constant 
-    ref<EqExpr> eq = dyn_cast<EqExpr>(e.get());
+    // where X1 and X2 are linear in the symbols
     ref<Expr> left = e->getKid(0);
     ref<Expr> right = e->getKid(1);
 
-    // Return pair: <Num of symblics, Value of constants>
-    std::pair<int32_t, int32_t> p1 = evaluate(left);
-    std::pair<int32_t, int32_t> p2 = evaluate(right);
+    // X1 - X2 == c + k * x, using the forms cached in the nodes, where
+    // every symbol stands for the one object being solved for.
+    LinearForm form(left->getWidth());
+    if (!form.add(left.get()) || !form.add(right.get(), -1))
+        unsupported(e);
 
-    int valueConst = p2.first - p1.first;
-    int numSym = p1.second - p2.second;
+    int32_t valueConst = static_cast<int32_t>(0u - static_cast<std::uint32_t>(form.constant));
+    int32_t numSym = 0;
+    for (const LinearForm::Term &t : form.terms)
+        numSym += static_cast<int32_t>(t.coefficient);
 
     if (numSym == 0)
         assert(valueConst == 0 && "Invalid expression");
-    else {
+    else if (numSym == 1 || numSym == -1) {
+        // Wraps like the program does; INT32_MIN / -1 would trap.
+        res = static_cast<int32_t>(static_cast<std::uint32_t>(valueConst) *
+                                   static_cast<std::uint32_t>(numSym));
+    } else {
         res = valueConst / numSym;
     }
 }
 
-std::pair<int32_t, int32_t> TinySolverImpl::evaluate(ref<Expr> e) {
-    switch (e->getKind()) {
-    case Expr::Constant: {
-        auto *constant = dyn_cast<ConstantExpr>(e.get());
-        return std::pair<int32_t, int32_t>(
-                constant->getAPValue().getSExtValue(),
-                0 /* Number of symbolic variables */);
-        break;
-    }
-    case Expr::Symbolic: {
-        return std::pair<int32_t, int32_t>(
-                0 /* Value of constant */,
-                1 /* Number of symbolic variables */);
-        break;
-    }
-    case Expr::Add: {
-        auto *add = dyn_cast<AddExpr>(e.get());
-        auto p1 = evaluate(add->getKid(0));
-        auto p2 = evaluate(add->getKid(1));
-        return std::pair<int32_t, int32_t>(
-                p1.first + p2.first,
-                p1.second + p2.second);
-        break;
-    }
-    case Expr::Sub: {
-        auto *sub = dyn_cast<SubExpr>(e.get());
-        auto p1 = evaluate(sub->getKid(0));
-        auto p2 = evaluate(sub->getKid(1));
-        return std::pair<int32_t, int32_t>(
-                p1.first - p2.first,
-                p1.second - p2.second);
-        break;
-    }
-    default:
-        assert(false && "unhandled expression kind");
-    }
-}
-
 SolverImpl::SolverRunStatus TinySolverImpl::getOperationStatusCode() {
     return SOLVER_RUN_STATUS_FAILURE;
 }
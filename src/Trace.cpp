@@ -0,0 +1,218 @@
+#include "Trace.h"
+
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace miniklee;
+using namespace miniklee::trace;
+
+namespace {
+llvm::cl::opt<Level> TraceLevel(
+    "trace-level",
+    llvm::cl::desc("Trace events up to this level (default=none)"),
+    llvm::cl::values(
+        clEnumValN(None, "none", "no tracing"),
+        clEnumValN(Error, "error", "errors only"),
+        clEnumValN(Info, "info", "forks and other state changes"),
+        clEnumValN(Debug, "debug", "every instruction and solver assignment")),
+    llvm::cl::init(None));
+
+llvm::cl::list<Category> TraceCategories(
+    "trace",
+    llvm::cl::desc("Categories to trace (default=all)"),
+    llvm::cl::values(
+        clEnumValN(Executor, "executor", "instruction execution"),
+        clEnumValN(Fork, "fork", "state forking"),
+        clEnumValN(Solver, "solver", "solver queries")),
+    llvm::cl::CommaSeparated);
+
+llvm::cl::opt<unsigned> TraceBufferSize(
+    "trace-buffer",
+    llvm::cl::desc("Keep the last N trace events per thread in an in-memory "
+                   "ring buffer, written out on exit or crash. 0 prints "
+                   "events as they happen (default=0)"),
+    llvm::cl::init(0));
+
+/// Longest formatted event, newline included; longer ones are truncated.
+const unsigned MaxLine = 256;
+
+/// Sequenced event, so the per-thread rings can be merged back in order.
+/// Events are formatted when recorded, so flushing, possibly from a signal
+/// handler, only copies bytes.
+struct Slot {
+    std::uint64_t sequence;
+    unsigned length;
+    char text[MaxLine];
+};
+
+/// Fixed-size ring owned by one thread. Rings outlive their threads so a
+/// worker's last events are still flushed at exit.
+struct RingBuffer {
+    std::vector<Slot> slots;
+    std::uint64_t next = 0;
+    /// Next event to write out, used while flushing.
+    std::uint64_t cursor = 0;
+
+    explicit RingBuffer(unsigned size) : slots(size) {}
+};
+
+unsigned bufferSize = 0;
+std::atomic<std::uint64_t> sequence(0);
+std::mutex lock;
+std::vector<std::unique_ptr<RingBuffer>> rings;
+
+RingBuffer *getRing() {
+    thread_local RingBuffer *ring = nullptr;
+    if (!ring) {
+        std::lock_guard<std::mutex> guard(lock);
+        rings.emplace_back(new RingBuffer(bufferSize));
+        ring = rings.back().get();
+    }
+    return ring;
+}
+
+/// Format \p e into \p out, which holds MaxLine bytes, and return the
+/// length. Does not allocate.
+unsigned format(char *out, const Event &e) {
+    const unsigned limit = MaxLine - 1; // Room for the newline.
+    unsigned n = 0;
+    unsigned arg = 0;
+    for (const char *p = e.message; *p && n < limit; ++p) {
+        if (p[0] == '{' && p[1] == '}' && arg < e.numArgs) {
+            std::int64_t value = e.args[arg++];
+            std::uint64_t magnitude = value < 0 ? 0 - static_cast<std::uint64_t>(value)
+                                                : static_cast<std::uint64_t>(value);
+            char digits[20];
+            unsigned numDigits = 0;
+            do {
+                digits[numDigits++] = '0' + magnitude % 10;
+                magnitude /= 10;
+            } while (magnitude);
+            if (value < 0 && n < limit)
+                out[n++] = '-';
+            while (numDigits && n < limit)
+                out[n++] = digits[--numDigits];
+            ++p;
+        } else {
+            out[n++] = *p;
+        }
+    }
+    out[n++] = '\n';
+    return n;
+}
+
+void writeAll(const char *data, std::size_t size) {
+    while (size) {
+        ssize_t written = ::write(STDERR_FILENO, data, size);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+/// Write the buffered events out in sequence order and clear the rings.
+/// Call with the lock held. Only write(2) is used, so this may run in a
+/// signal handler.
+void flushRings() {
+    for (auto &ring : rings) {
+        std::uint64_t size = ring->slots.size();
+        ring->cursor = ring->next > size ? ring->next - size : 0;
+    }
+
+    // Merge the rings, each already in sequence order, through one buffer.
+    static char out[64 * MaxLine];
+    std::size_t used = 0;
+    while (true) {
+        RingBuffer *min = nullptr;
+        for (auto &ring : rings) {
+            if (ring->cursor == ring->next)
+                continue;
+            const Slot &slot = ring->slots[ring->cursor % ring->slots.size()];
+            if (!min || slot.sequence <
+                            min->slots[min->cursor % min->slots.size()].sequence)
+                min = ring.get();
+        }
+        if (!min)
+            break;
+
+        const Slot &slot = min->slots[min->cursor++ % min->slots.size()];
+        if (used + slot.length > sizeof(out)) {
+            writeAll(out, used);
+            used = 0;
+        }
+        std::copy(slot.text, slot.text + slot.length, out + used);
+        used += slot.length;
+    }
+    writeAll(out, used);
+
+    for (auto &ring : rings)
+        ring->next = 0;
+}
+
+void flushOnSignal(void *) {
+    // The crashing thread may hold the lock, and the rings with it.
+    std::unique_lock<std::mutex> guard(lock, std::try_to_lock);
+    if (!guard.owns_lock())
+        return;
+    flushRings();
+}
+
+void flushOnExit() { flush(); }
+} // namespace
+
+unsigned trace::activeLevel = None;
+unsigned trace::activeCategories = Executor | Fork | Solver;
+
+void trace::initialize() {
+    activeLevel = TraceLevel;
+    if (!TraceCategories.empty()) {
+        activeCategories = 0;
+        for (Category c : TraceCategories)
+            activeCategories |= c;
+    }
+
+    bufferSize = TraceBufferSize;
+    if (activeLevel != None && bufferSize) {
+        std::atexit(flushOnExit);
+        llvm::sys::AddSignalHandler(flushOnSignal, nullptr);
+    }
+}
+
+void trace::record(const Event &e) {
+    if (!bufferSize) {
+        // Format outside the lock and issue a single write per event.
+        char line[MaxLine];
+        unsigned length = format(line, e);
+        std::lock_guard<std::mutex> guard(lock);
+        llvm::errs().write(line, length);
+        return;
+    }
+
+    RingBuffer *ring = getRing();
+    Slot &slot = ring->slots[ring->next % ring->slots.size()];
+    slot.sequence = sequence.fetch_add(1, std::memory_order_relaxed);
+    slot.length = format(slot.text, e);
+    ++ring->next;
+}
+
+void trace::flush() {
+    std::lock_guard<std::mutex> guard(lock);
+    // Keep anything already printed through errs() ahead of the rings.
+    llvm::errs().flush();
+    flushRings();
+}
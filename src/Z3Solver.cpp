@@ -144,7 +144,7 @@ bool Z3SolverImpl::internalRunSolver(
     runStatusCode = SOLVER_RUN_STATUS_FAILURE;
 
     ConstantSymbolicExprFinder constant_arrays_in_query;
-    for (auto const &constraint : query.constraints) {
+    for (auto const &constraint : query.constraints.toVector()) {
         // TODO: Construct the builder
         Z3_solver_assert(builder->ctx, theSolver, builder->construct(constraint));
         constant_arrays_in_query.visit(constraint);
@@ -1,18 +1,53 @@
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/CommandLine.h>
 #include <llvm/Support/SourceMgr.h>
 
 #include "Executor.h"
+#include "Trace.h"
+
+namespace {
+llvm::cl::opt<std::string> InputFile(llvm::cl::Positional,
+                                     llvm::cl::desc("<path_to_LLVM_IR_file>"),
+                                     llvm::cl::Required);
+
+llvm::cl::list<SearcherType> Searchers(
+    "search",
+    llvm::cl::desc("Specify the search heuristic (default=dfs). Given more "
+                   "than once, the searchers are interleaved round-robin"),
+    llvm::cl::values(
+        clEnumValN(SearcherType::DFS, "dfs", "use Depth First Search"),
+        clEnumValN(SearcherType::BFS, "bfs", "use Breadth First Search"),
+        clEnumValN(SearcherType::RandomState, "random-state",
+                   "randomly select a state to explore"),
+        clEnumValN(SearcherType::NURS_Depth, "nurs:depth",
+                   "use Non Uniform Random Search (NURS) with depth"),
+        clEnumValN(SearcherType::NURS_RP, "nurs:rp",
+                   "use NURS with 1/2^depth")),
+    llvm::cl::CommaSeparated);
+
+llvm::cl::opt<unsigned> Workers(
+    "workers",
+    llvm::cl::desc("Number of worker threads exploring states with work "
+                   "stealing (default=1). Values above 1 bypass the "
+                   "searcher: --search is ignored and each worker runs "
+                   "its newest state first"),
+    llvm::cl::init(1));
+}
 
 int main(int argc, char** argv) {
-    if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " <path_to_LLVM_IR_file>\n";
+    llvm::cl::ParseCommandLineOptions(argc, argv, "MiniKLEE\n");
+    trace::initialize();
+
+    if (Workers > 1 && !DefaultRefCountPolicy::ThreadSafe) {
+        llvm::errs() << argv[0] << ": --workers requires atomic reference "
+                     << "counting; rebuild without REFCOUNT=plain\n";
         return 1;
     }
 
     // Get the file path from user input
-    const char* filePath = argv[1];
+    const char* filePath = InputFile.c_str();
     llvm::LLVMContext context;
     llvm::SMDiagnostic err;
 
@@ -27,8 +62,22 @@ int main(int argc, char** argv) {
 
     // Create the executor to interpret the program
     Executor executor(std::move(module));
+
+    std::vector<SearcherType> types(Searchers.begin(), Searchers.end());
+    if (types.empty())
+        types.push_back(SearcherType::DFS);
+    executor.setSearcher(createSearcher(types, executor.rng));
+
     auto mainFunc = executor.module->getFunction("main");
-    executor.runFunctionAsMain(mainFunc);
+    auto start = time::getWallTime();
+    if (Workers > 1)
+        executor.runFunctionAsMainParallel(mainFunc, Workers);
+    else
+        executor.runFunctionAsMain(mainFunc);
+    auto elapsed = time::getWallTime() - start;
+
+    std::cout << GREEN_TEXT("Explored ") << executor.pathsExplored
+              << GREEN_TEXT(" paths in ") << elapsed << std::endl;
 
     return 0;
 }
@@ -0,0 +1,83 @@
+// Checks that dropping a deep expression does not recurse.
+//
+// Builds a chain of Depth nested Add nodes on a thread with a 1 MB stack,
+// where freeing it one node per frame would overflow, drops the last
+// reference and checks that every node was freed. Also checks that with
+// deferred reclamation the nodes stay alive until reclaimPending() frees
+// them within its budget.
+
+#include <chrono>
+#include <cstdio>
+
+#include <pthread.h>
+
+#include "Expr.h"
+
+using namespace miniklee;
+
+namespace {
+
+const unsigned Depth = 100000;
+const std::size_t StackSize = 1 << 20;
+
+typedef std::chrono::steady_clock Clock;
+
+ref<Expr> makeChain(const ref<Expr> &x) {
+    ref<Expr> e = x;
+    for (unsigned i = 0; i < Depth; ++i)
+        e = AddExpr::alloc(e, x);
+    return e;
+}
+
+bool failed = false;
+
+void expect(bool ok, const char *what) {
+    if (!ok) {
+        std::printf("FAILED: %s\n", what);
+        failed = true;
+    }
+}
+
+void *run(void *) {
+    ref<Expr> x = SymbolicExpr::create("x");
+    unsigned live = Expr::count;
+
+    {
+        ref<Expr> chain = makeChain(x);
+        expect(Expr::count == live + Depth, "chain built");
+        auto start = Clock::now();
+        chain = ref<Expr>();
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        expect(Expr::count == live, "chain freed when dropped");
+        std::printf("Reclaim: dropped a %u deep chain on a 1 MB stack in %.1f ms\n", Depth, ms);
+    }
+
+    {
+        Expr::setDeferredReclamation(true);
+        ref<Expr> chain = makeChain(x);
+        chain = ref<Expr>();
+        expect(Expr::count == live + Depth, "deferred chain kept until reclaimed");
+        std::size_t left = Expr::reclaimPending(256);
+        expect(left > 0 && Expr::count == live + Depth - 256, "budget respected");
+        Expr::reclaimPending();
+        expect(Expr::count == live, "deferred chain freed");
+        Expr::setDeferredReclamation(false);
+    }
+    return nullptr;
+}
+
+} // namespace
+
+int main() {
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, StackSize);
+    pthread_t thread;
+    if (pthread_create(&thread, &attr, run, nullptr) != 0) {
+        std::printf("FAILED: cannot create thread\n");
+        return 1;
+    }
+    pthread_join(thread, nullptr);
+    pthread_attr_destroy(&attr);
+    return failed;
+}
@@ -0,0 +1,122 @@
+// Checks TinySolver on comparisons of one object against brute force.
+//
+// Queries combine Eq, Ne and the ordered comparisons of x, x + c and
+// c - x against constants, negated at random, with constants at the
+// wrapping and sign boundaries. Their satisfiable regions are intervals
+// ending next to those constants, so evaluating the query at each
+// boundary and its neighbours decides it exactly. Validity, satisfiability
+// and the model returned must all agree with that.
+
+#include <cstdio>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "BatchEvaluator.h"
+#include "Constraints.h"
+#include "Solver.h"
+
+using namespace miniklee;
+
+namespace {
+
+const unsigned NumQueries = 20000;
+const std::uint32_t Constants[] = {0, 1, 2, 5, 7, 8, 10, 100, 0xffffff9cu, 0x7fffffffu,
+                                   0x80000000u, 0x80000001u, 0xfffffffeu, 0xffffffffu};
+const std::size_t NumConstants = sizeof(Constants) / sizeof(Constants[0]);
+
+bool holds(const ref<Expr> &e, std::int32_t x) {
+    BatchEvaluator evaluator(e);
+    std::vector<const std::int32_t *> inputs(evaluator.getSymbols().size(), &x);
+    std::uint8_t satisfied;
+    evaluator.filter(inputs.data(), 1, &satisfied);
+    return satisfied;
+}
+
+ref<Expr> makeCondition(std::mt19937 &rng, const ref<Expr> &x) {
+    ref<Expr> k = ConstantExpr::create(Constants[rng() % NumConstants], Expr::Int32);
+    ref<Expr> c = ConstantExpr::create(Constants[rng() % NumConstants], Expr::Int32);
+    ref<Expr> side = x;
+    if (rng() % 3 == 1)
+        side = AddExpr::create(c, x);
+    else if (rng() % 3 == 2)
+        side = SubExpr::create(c, x);
+
+    ref<Expr> e;
+    switch (rng() % 10) {
+    case 0: e = UltExpr::create(side, k); break;
+    case 1: e = UleExpr::create(side, k); break;
+    case 2: e = SltExpr::create(side, k); break;
+    case 3: e = SleExpr::create(side, k); break;
+    case 4: e = UgtExpr::create(side, k); break;
+    case 5: e = UgeExpr::create(side, k); break;
+    case 6: e = SgtExpr::create(side, k); break;
+    case 7: e = SgeExpr::create(side, k); break;
+    default: e = EqExpr::create(x, k); break;
+    }
+    return rng() % 2 ? Expr::createIsZero(e) : e;
+}
+
+} // namespace
+
+int main() {
+    std::unique_ptr<Solver> solver = createTinySolver();
+    ref<Expr> x = SymbolicExpr::create("x");
+    std::vector<const SymbolicExpr *> objects(1, cast<SymbolicExpr>(x.get()));
+
+    // Every region boundary is some k - c or c - k, give or take one.
+    std::set<std::uint32_t> points;
+    for (std::uint32_t k : Constants)
+        for (std::uint32_t c : Constants)
+            for (int d = -2; d <= 2; ++d) {
+                points.insert(k + c + d);
+                points.insert(k - c + d);
+            }
+
+    std::mt19937 rng(1);
+    unsigned queries = 0, mismatches = 0;
+    while (queries < NumQueries) {
+        std::vector<ref<Expr>> conditions;
+        for (unsigned i = 0, n = 1 + rng() % 4; i < n; ++i) {
+            ref<Expr> c = makeCondition(rng, x);
+            if (!isa<ConstantExpr>(c.get()))
+                conditions.push_back(c);
+        }
+        if (conditions.empty())
+            continue;
+        ref<Expr> expr = conditions.back();
+        conditions.pop_back();
+        ConstraintSet constraints(conditions);
+        ++queries;
+
+        bool canHold = false, canFail = false;
+        for (std::uint32_t p : points) {
+            std::int32_t v = static_cast<std::int32_t>(p);
+            bool ok = true;
+            for (const ref<Expr> &c : conditions)
+                ok = ok && holds(c, v);
+            if (ok)
+                (holds(expr, v) ? canHold : canFail) = true;
+        }
+
+        Query query(constraints, expr);
+        bool valid;
+        if (!solver->mustBeTrue(query, valid) || valid != !canFail)
+            ++mismatches;
+
+        std::vector<std::vector<std::int32_t>> values(1);
+        bool satisfiable = solver->getInitialValues(query, objects, values);
+        if (satisfiable != canHold) {
+            ++mismatches;
+        } else if (satisfiable) {
+            std::int32_t v = values[0][0];
+            bool ok = holds(expr, v);
+            for (const ref<Expr> &c : conditions)
+                ok = ok && holds(c, v);
+            mismatches += !ok;
+        }
+    }
+
+    std::printf("TinySolver: %u queries, %u mismatches\n", queries, mismatches);
+    return mismatches != 0;
+}
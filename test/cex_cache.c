@@ -0,0 +1,36 @@
+#include "../include/Symbolic.h"
+
+int main() {
+    int a = 1;
+
+    make_symbolic(&a, sizeof(a), "a");
+
+    // The counterexample cache answers most of these branches without the
+    // solver.
+    int i = 0;
+    if (a == 5) {
+        // The model a = 5 of the path so far takes every branch below
+        // the same way, so only the other side of each is solved.
+        if (a > 3) {
+            // Should reach, a is 5
+            i += 1;
+        }
+        if (a > 3) {
+            // Should reach. The query for the other side is a superset of
+            // the unsatisfiable { a == 5, a <= 3 } stored above.
+            i += 1;
+        }
+    } else {
+        if (a < 0) {
+            // Should reach, a is negative
+            i += 1;
+            if (a < 10) {
+                // Should reach. The model stored for the subset
+                // { a != 5, a < 0 } satisfies a < 10 too.
+                i += 1;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,19 @@
+#include "../include/Symbolic.h"
+
+int main() {
+    int a = 1;
+
+    make_symbolic(&a, sizeof(a), "a");
+
+    // A chain of 300 branches, each ending one path: 301 paths in all.
+    // The model of each path condition decides the side where a is not k,
+    // so only the other side of each branch reaches the solver.
+    for (int k = 0; k < 300; k++) {
+        if (a == k) {
+            // Should reach, a must be k
+            return k;
+        }
+    }
+
+    return 0;
+}
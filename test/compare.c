@@ -0,0 +1,57 @@
+#include "../include/Symbolic.h"
+
+int main() {
+    int a = 1;
+
+    make_symbolic(&a, sizeof(a), "a");
+
+    // Every comparison below can go either way, so each one forks. The
+    // paths that survive are those whose conditions a single a satisfies.
+    int i = 0;
+    if (a < -100) {
+        // Should reach, a is below -100
+        i += 1;
+    }
+    if (a <= 50) {
+        // Should reach, a is at most 50
+        i += 1;
+    }
+    if (a > 1000) {
+        // Should reach, a is above 1000
+        i += 1;
+    }
+    if (a >= 2000) {
+        // Should reach, a is at least 2000
+        i += 1;
+    }
+    if ((unsigned) a < 10u) {
+        // Should reach, a is in [0, 10)
+        i += 1;
+    }
+    if ((unsigned) a <= 20u) {
+        // Should reach, a is in [0, 20]
+        i += 1;
+    }
+    if ((unsigned) a > 3000000000u) {
+        // Should reach, a is negative, below -1294967296
+        i += 1;
+    }
+    if ((unsigned) a >= 5u) {
+        // Should reach, a is not in [0, 5)
+        i += 1;
+    }
+    if (a == 7) {
+        // Should reach, a must be 7
+        i += 1;
+    }
+    if (a != 8) {
+        // Should reach, a can be assigned all values that are not 8
+        i += 1;
+    }
+    if (10 - a < 3) {
+        // Should reach, 10 - a is below 3
+        i += 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,41 @@
+#include "../include/Symbolic.h"
+
+int main() {
+    int a = 1;
+    int b = 2;
+    int c = 3;
+    int d = 4;
+
+    make_symbolic(&a, sizeof(a), "a");
+    make_symbolic(&b, sizeof(b), "b");
+    make_symbolic(&c, sizeof(c), "c");
+    make_symbolic(&d, sizeof(d), "d");
+
+    // No condition mentions two inputs, so each is an independent group:
+    // a query about one input is solved with that input's constraints
+    // only, and the others are never forwarded.
+    int i = 0;
+    if (a == 10) {
+        // Should reach, a must be 10
+        i += 1;
+    }
+    if (b + 2 == 20) {
+        // Should reach, b must be 18
+        i += 1;
+    }
+    if (c < 30) {
+        // Should reach, c is below 30
+        i += 1;
+    }
+    if (d != 40) {
+        // Should reach, d can be assigned all values that are not 40
+        i += 1;
+    }
+    if (a == 11) {
+        // Should reach where a is not 10. Only the constraints on a are
+        // forwarded with this query
+        i += 1;
+    }
+
+    return 0;
+}